@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#else
+#define BENCH_HAS_TSC 0
+#endif
+
+#include "gameboy.h"
+
+#define BENCH_ADDRESS 0x0100
+#define BENCH_RUNS 5
+
+// Every opcode handler runs on its own from the same machine state: the instruction sits at BENCH_ADDRESS, the
+// pointer registers aim at WRAM and the stack at HRAM. Restoring the registers before each tick keeps jumps, calls
+// and register walks like LD (HL+),A from leaving that state, the cost of doing so is reported as overhead_ns.
+typedef struct {
+    double ns;
+    double host_cycles;
+} sample_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t host_cycles(void) {
+#if BENCH_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void prepare(gameboy_t *gb, cpu_t *start, uint8_t opcode) {
+    // The a16 operand reads as 0xc000 or 0x00c0 depending on byte order, both harmless.
+    uint8_t code[4] = { opcode, 0x00, 0xc0, 0x00 };
+
+    bus_copy_in(&gb->bus, BENCH_ADDRESS, code, sizeof(code));
+
+    *start = gb->cpu;
+    start->registers.dw.BC = 0xc010;
+    start->registers.dw.DE = 0xc020;
+    start->registers.dw.HL = 0xc030;
+    start->registers.dw.SP = 0xfffe;
+    start->registers.dw.PC = BENCH_ADDRESS;
+}
+
+// Not inlined so start stays put in memory, otherwise the per-iteration spill of it costs more than most handlers.
+static __attribute__((noinline)) sample_t measure(gameboy_t *gb, const cpu_t *start, long iterations, int tick) {
+    sample_t best = { 0, 0 };
+
+    for (int run = -1; run < BENCH_RUNS; run++) { // Run -1 only warms caches and the page tables.
+        uint64_t begin = now_ns();
+        uint64_t begin_cycles = host_cycles();
+
+        for (long i = 0; i < iterations; i++) {
+            gb->cpu = *start;
+            if (tick) cpu_tick(&gb->cpu, &gb->bus);
+            __asm__ volatile("" ::: "memory");
+        }
+
+        double ns = (double) (now_ns() - begin) / iterations;
+        double cycles = (double) (host_cycles() - begin_cycles) / iterations;
+
+        if (run >= 0 && (run == 0 || ns < best.ns)) {
+            best.ns = ns;
+            best.host_cycles = cycles;
+        }
+    }
+
+    return best;
+}
+
+// The core stops on instructions it doesn't execute yet and reads the next byte as a CB opcode. STOP is the only
+// opcode that stops on purpose.
+static int implemented(gameboy_t *gb, const cpu_t *start, uint8_t opcode) {
+    gb->cpu = *start;
+    cpu_tick(&gb->cpu, &gb->bus);
+
+    return !gb->cpu.state.stopped || opcode == 0x10;
+}
+
+static void print_op(const op_t *op, int valid, sample_t sample, sample_t overhead, int last) {
+    double ns = sample.ns - overhead.ns > 0 ? sample.ns - overhead.ns : 0;
+    double cycles = sample.host_cycles - overhead.host_cycles > 0 ? sample.host_cycles - overhead.host_cycles : 0;
+
+    printf("    { \"opcode\": \"0x%02x\", \"name\": \"%s\", \"t_cycles\": %d, ", op->value, op->name, op->timing);
+
+    if (!valid) {
+        printf("\"implemented\": false, \"ns_per_op\": null, \"host_cycles_per_op\": null, \"emulated_mhz\": null }%s\n",
+               last ? "" : ",");
+        return;
+    }
+
+    printf("\"implemented\": true, \"ns_per_op\": %.3f, ", ns);
+
+    if (BENCH_HAS_TSC) {
+        printf("\"host_cycles_per_op\": %.2f, ", cycles);
+    } else {
+        printf("\"host_cycles_per_op\": null, ");
+    }
+
+    // Emulated clock rate if the whole program consisted of this instruction.
+    printf("\"emulated_mhz\": %.1f }%s\n", ns > 0 ? op->timing / ns * 1000 : 0, last ? "" : ",");
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? strtol(argv[1], NULL, 10) : 200000;
+    if (iterations <= 0) {
+        fprintf(stderr, "usage: cgb_bench [iterations per opcode]\n");
+        return 1;
+    }
+
+    gameboy_t *gb = gameboy_create();
+    cpu_t start;
+
+    prepare(gb, &start, 0x00);
+    sample_t overhead = measure(gb, &start, iterations, 0);
+
+    printf("{\n");
+    printf("  \"iterations\": %ld,\n", iterations);
+    printf("  \"runs\": %d,\n", BENCH_RUNS);
+    printf("  \"host_cycles\": \"%s\",\n", BENCH_HAS_TSC ? "tsc" : "none");
+    printf("  \"overhead_ns\": %.3f,\n", overhead.ns);
+    // The core treats CB opcodes as no-ops, timing them would only measure the prefix dispatch.
+    printf("  \"cb_ops\": \"omitted, not implemented by the core\",\n");
+    printf("  \"ops\": [\n");
+
+    int count = 0;
+    int total = 0;
+
+    for (int i = 0; i < 256; i++) {
+        if (cpu_ops[i].name != NULL && i != 0xcb) total++;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        if (cpu_ops[i].name == NULL || i == 0xcb) continue;
+
+        gameboy_reset(gb, NULL, 0);
+        prepare(gb, &start, i);
+
+        int valid = implemented(gb, &start, i);
+        sample_t sample = valid ? measure(gb, &start, iterations, 1) : (sample_t) { 0, 0 };
+        print_op(&cpu_ops[i], valid, sample, overhead, ++count == total);
+    }
+
+    printf("  ]\n");
+    printf("}\n");
+
+    gameboy_destroy(gb);
+    return 0;
+}
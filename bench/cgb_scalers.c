@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "components/ppu.h"
+#include "scaler.h"
+#include "video.h"
+
+#define SCALER_BENCH_RUNS 3
+#define SCALER_BENCH_FRAME_NS 16742706.0 // One DMG frame, 70224 cycles at 4.194304 MHz.
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Tiles, diagonals and a circle, so the filters find edges in every direction.
+static void draw_test_frame(uint8_t *framebuffer) {
+    for (int y = 0; y < PPU_HEIGHT; y++) {
+        for (int x = 0; x < PPU_WIDTH; x++) {
+            int dx = x - PPU_WIDTH / 2;
+            int dy = y - PPU_HEIGHT / 2;
+            uint8_t shade = (uint8_t) ((x / 8 + y / 8) & 1);
+
+            if ((x + y) % 13 == 0 || (x - y + PPU_HEIGHT) % 17 == 0) shade = 2;
+            if (dx * dx + dy * dy < 40 * 40) shade = 3 - shade;
+
+            framebuffer[y * PPU_WIDTH + x] = shade;
+        }
+    }
+}
+
+// Best of SCALER_BENCH_RUNS, in ns per frame.
+static double measure(scaler_t *scaler, scaler_filter_t filter, const uint32_t *frame, uint32_t *dst, long frames) {
+    size_t pitch = PPU_WIDTH * scaler_factor(filter) * sizeof(uint32_t);
+    double best = 0;
+
+    for (int run = 0; run < SCALER_BENCH_RUNS; run++) {
+        uint64_t begin = now_ns();
+
+        for (long i = 0; i < frames; i++) {
+            scaler_run(scaler, filter, frame, PPU_WIDTH * sizeof(uint32_t), dst, pitch);
+        }
+
+        double ns = (double) (now_ns() - begin) / (double) frames;
+        if (run == 0 || ns < best) best = ns;
+    }
+
+    return best;
+}
+
+int main(int argc, char **argv) {
+    long frames = argc > 1 ? strtol(argv[1], NULL, 10) : 500;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+
+    if (frames <= 0 || threads < 0) {
+        fprintf(stderr, "usage: cgb_scalers [frames] [threads]\n");
+        return 1;
+    }
+
+    uint8_t framebuffer[PPU_WIDTH * PPU_HEIGHT];
+    uint32_t *frame = malloc(PPU_WIDTH * PPU_HEIGHT * sizeof(uint32_t));
+    uint32_t *dst = malloc(PPU_WIDTH * PPU_HEIGHT * sizeof(uint32_t) * 16);
+
+    draw_test_frame(framebuffer);
+    video_convert(framebuffer, &video_palette_dmg, VIDEO_RGBA8888, 1, frame, PPU_WIDTH * sizeof(uint32_t));
+
+    // The single threaded run is the baseline the pool has to beat.
+    scaler_t *single = scaler_create(1);
+    scaler_t *pooled = scaler_create(threads);
+
+    printf("{\n");
+    printf("  \"frames\": %ld,\n", frames);
+    printf("  \"runs\": %d,\n", SCALER_BENCH_RUNS);
+    printf("  \"filters\": [\n");
+
+    for (int filter = 0; filter < SCALER_COUNT; filter++) {
+        int factor = scaler_factor(filter);
+        double single_ns = measure(single, filter, frame, dst, frames);
+        double pooled_ns = measure(pooled, filter, frame, dst, frames);
+        double pixels = (double) PPU_WIDTH * PPU_HEIGHT * factor * factor;
+
+        printf("    { \"name\": \"%s\", \"factor\": %d, \"us_per_frame_1_thread\": %.2f, \"us_per_frame_pool\": %.2f, "
+               "\"output_mpixels_per_second\": %.1f, \"share_of_frame_time\": %.4f }%s\n",
+               scaler_name(filter), factor, single_ns / 1e3, pooled_ns / 1e3, pixels / pooled_ns * 1e3,
+               pooled_ns / SCALER_BENCH_FRAME_NS, filter + 1 == SCALER_COUNT ? "" : ",");
+    }
+
+    printf("  ]\n");
+    printf("}\n");
+
+    scaler_destroy(single);
+    scaler_destroy(pooled);
+    free(frame);
+    free(dst);
+    return 0;
+}
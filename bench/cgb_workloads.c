@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "asm.h"
+#include "gameboy.h"
+
+#ifndef CGB_WORKLOAD_DIR
+#define CGB_WORKLOAD_DIR "bench/workloads"
+#endif
+
+#define WORKLOAD_WARM_UP_FRAMES 60
+#define WORKLOAD_RUNS 3
+#define WORKLOAD_CLOCK_HZ 4194304.0
+
+// Synthetic guest programs in bench/workloads, assembled on every run so they can't go stale.
+static const char *const workloads[] = { "alu", "memcpy", "dispatch", "polling" };
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint8_t *assemble(const char *dir, const char *name) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.asm", dir, name);
+
+    uint8_t *rom = calloc(1, GAMEBOY_ROM_SIZE);
+    asm_error_t error;
+
+    if (asm_assemble_file(path, rom, GAMEBOY_ROM_SIZE, &error) < 0) {
+        if (error.line > 0) {
+            fprintf(stderr, "%s:%d: %s\n", path, error.line, error.message);
+        } else {
+            fprintf(stderr, "%s: %s\n", path, error.message);
+        }
+
+        free(rom);
+        return NULL;
+    }
+
+    return rom;
+}
+
+// Best of WORKLOAD_RUNS, each from a clone of the same warmed up machine. Returns the emulated cycles of that run.
+static uint64_t measure(gameboy_t *warm, long frames, double *seconds, int *stopped) {
+    uint64_t cycles = 0;
+    *seconds = 0;
+    *stopped = 0;
+
+    for (int run = 0; run < WORKLOAD_RUNS; run++) {
+        gameboy_t *gb = gameboy_clone(warm);
+        uint64_t start_cycles = gb->cycles;
+        uint64_t begin = now_ns();
+
+        for (long frame = 0; frame < frames; frame++) {
+            gameboy_run_frame(gb);
+        }
+
+        double elapsed = (double) (now_ns() - begin) / 1e9;
+
+        if (run == 0 || elapsed < *seconds) {
+            *seconds = elapsed;
+            cycles = gb->cycles - start_cycles;
+        }
+
+        if (gb->cpu.state.stopped) *stopped = 1;
+        gameboy_destroy(gb);
+    }
+
+    return cycles;
+}
+
+int main(int argc, char **argv) {
+    long frames = argc > 1 ? strtol(argv[1], NULL, 10) : 600;
+    const char *dir = argc > 2 ? argv[2] : CGB_WORKLOAD_DIR;
+
+    if (frames <= 0) {
+        fprintf(stderr, "usage: cgb_workloads [frames] [workload directory]\n");
+        return 1;
+    }
+
+    size_t count = sizeof(workloads) / sizeof(workloads[0]);
+
+    printf("{\n");
+    printf("  \"frames\": %ld,\n", frames);
+    printf("  \"runs\": %d,\n", WORKLOAD_RUNS);
+    printf("  \"workloads\": [\n");
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t *rom = assemble(dir, workloads[i]);
+        if (rom == NULL) return 1;
+
+        gameboy_t *gb = gameboy_create();
+        gameboy_reset(gb, rom, GAMEBOY_ROM_SIZE);
+
+        for (int frame = 0; frame < WORKLOAD_WARM_UP_FRAMES; frame++) {
+            gameboy_run_frame(gb);
+        }
+
+        double seconds;
+        int stopped;
+        uint64_t cycles = measure(gb, frames, &seconds, &stopped);
+        double per_second = seconds > 0 ? cycles / seconds : 0;
+
+        // A workload that ran into an instruction this core doesn't execute measures nothing useful.
+        if (stopped) fprintf(stderr, "%s stopped the CPU\n", workloads[i]);
+
+        printf("    { \"name\": \"%s\", \"emulated_cycles\": %llu, \"seconds\": %.6f, "
+               "\"cycles_per_second\": %.0f, \"emulated_mhz\": %.2f, \"realtime\": %.1f, \"stopped\": %s }%s\n",
+               workloads[i], (unsigned long long) cycles, seconds, per_second, per_second / 1e6,
+               per_second / WORKLOAD_CLOCK_HZ, stopped ? "true" : "false", i + 1 == count ? "" : ",");
+
+        gameboy_destroy(gb);
+        free(rom);
+    }
+
+    printf("  ]\n");
+    printf("}\n");
+
+    return 0;
+}
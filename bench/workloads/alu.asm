@@ -0,0 +1,38 @@
+; ALU-heavy loop: 8-bit arithmetic and logic between registers, no memory traffic.
+
+    org $100
+    scf
+    jr c, main
+
+    org $150
+main:
+    ld a, $13
+    ld c, a
+    ld a, $37
+    ld d, a
+    ld e, $c4
+    ld a, $5a
+
+.outer:
+    ld b, 0 ; 256 iterations
+
+.loop:
+    add a, c
+    xor d
+    adc a, e
+    sub c
+    and $7f
+    or d
+    sbc a, e
+    ld h, a
+    xor e
+    ld l, a
+    add a, h
+    and l
+    inc e
+    ld c, e
+    or c
+    dec b
+    jr z, .outer
+    scf
+    jr c, .loop
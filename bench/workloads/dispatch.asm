@@ -0,0 +1,99 @@
+; Branchy dispatch: a linear congruential generator picks one of eight handlers through JP HL, and each handler
+; branches again on the value it got before jumping back. Handlers sit at $3030, $3838, ... $6868 so the target
+; can be built by loading the same byte into H and L.
+
+DISPATCH equ $2020
+
+    org $100
+    scf
+    jr c, main
+
+    org $150
+main:
+    ld e, 1
+    ld hl, DISPATCH
+    jp hl
+
+    org DISPATCH
+dispatch:
+    ld a, e ; e = 5e + 1
+    add a, a
+    add a, a
+    add a, e
+    add a, 1
+    ld e, a
+    and $38
+    add a, $30
+    ld h, a
+    ld l, a
+    jp hl
+
+    org $3030
+    inc b
+    ld hl, DISPATCH
+    jp hl
+
+    org $3838
+    ld a, e
+    and $40
+    jr z, .skip
+    inc b
+    inc b
+.skip:
+    ld hl, DISPATCH
+    jp hl
+
+    org $4040
+    dec b
+    ld hl, DISPATCH
+    jp hl
+
+    org $4848
+    ld a, e
+    and $80
+    jr z, .low
+    ld a, c
+    xor b
+    ld c, a
+    ld hl, DISPATCH
+    jp hl
+.low:
+    ld a, c
+    add a, b
+    ld c, a
+    ld hl, DISPATCH
+    jp hl
+
+    org $5050
+    ld a, b
+    add a, e
+    ld b, a
+    ld hl, DISPATCH
+    jp hl
+
+    org $5858
+    ld a, e
+    and $c0
+    jr z, .done
+    ld a, d
+    or b
+    ld d, a
+.done:
+    ld hl, DISPATCH
+    jp hl
+
+    org $6060
+    ld a, b
+    xor e
+    ld b, a
+    ld hl, DISPATCH
+    jp hl
+
+    org $6868
+    ld a, e
+    and 1
+    jr z, .even
+    dec b
+.even:
+    ld hl, DISPATCH
+    jp hl
@@ -0,0 +1,65 @@
+; Fills 2 KiB of WRAM with a pattern, then copies the first 256 bytes of it elsewhere a byte at a time, forever.
+; Pointers only move through INC HL and whole register pair moves.
+
+SOURCE equ $c0c0
+DEST equ $c8c8
+BLOCKS equ 8
+BLOCKS_LEFT equ $80 ; HRAM counter
+
+    org $100
+    scf
+    jr c, main
+
+    org $150
+main:
+    ld a, $a5
+    ld d, a
+    ld hl, SOURCE
+    ld a, BLOCKS
+    ldh [BLOCKS_LEFT], a
+
+.fill_block:
+    ld b, 0 ; 256 bytes
+
+.fill_byte:
+    ld [hl], d
+    inc hl
+    dec b
+    jr z, .fill_next
+    scf
+    jr c, .fill_byte
+
+.fill_next:
+    ldh a, [BLOCKS_LEFT]
+    dec a
+    ldh [BLOCKS_LEFT], a
+    jr z, .copy
+    scf
+    jr c, .fill_block
+
+.copy:
+    ld hl, SOURCE
+    ld de, DEST
+    ld b, 0 ; 256 bytes
+
+.copy_byte:
+    ld c, [hl]
+    inc hl
+    ld a, h ; swap HL and DE
+    ld h, d
+    ld d, a
+    ld a, l
+    ld l, e
+    ld e, a
+    ld [hl], c
+    inc hl
+    ld a, h
+    ld h, d
+    ld d, a
+    ld a, l
+    ld l, e
+    ld e, a
+    dec b
+    jr z, main
+    scf
+    jr c, .copy_byte
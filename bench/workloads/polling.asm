@@ -0,0 +1,30 @@
+; Idle loop of a game waiting for vblank: it reads the joypad and LY over and over until LY reaches 128, does a bit of
+; work, then waits for LY to leave vblank again.
+
+    org $100
+    scf
+    jr c, main
+
+    org $150
+main:
+    ld b, 0
+
+.wait_vblank:
+    ld a, $20
+    ldh [$00], a ; select the d-pad
+    ldh a, [$00]
+    ldh a, [$00]
+    ld e, a
+    ldh a, [$44]
+    and $80
+    jr z, .wait_vblank
+
+    inc b
+
+.wait_end:
+    ldh a, [$44]
+    cpl
+    and $80
+    jr z, .wait_end
+    scf
+    jr c, .wait_vblank
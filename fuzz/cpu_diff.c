@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "lockstep.h"
+
+#define FUZZ_LANES 8
+#define FUZZ_STATE_SIZE 10
+#define FUZZ_CODE_ADDRESS 0x0100
+#define FUZZ_CODE_MAX 1024
+#define FUZZ_STEPS 512
+#define FUZZ_BLOCK 16
+
+// Differential fuzzer: every backend runs the same instruction stream from the same states and has to end up
+// exactly where cpu_tick() does, compared after every block of FUZZ_BLOCK instructions.
+//
+// Input: one byte lane count, FUZZ_STATE_SIZE bytes per lane (A F B C D E H L SP), then the code, which goes to
+// FUZZ_CODE_ADDRESS in otherwise zeroed, fully writable memory. All lanes start at the same PC so the lockstep lanes
+// take their vector paths as long as they stay together.
+static gameboy_t *machines[BACKEND_COUNT][FUZZ_LANES];
+static lockstep_t lockstep;
+static cpu_probes_t probes;
+static uint8_t coverage[CPU_COVERAGE_SIZE];
+
+static void setup(void) {
+    for (int backend = 0; backend < BACKEND_COUNT; backend++) {
+        for (int lane = 0; lane < FUZZ_LANES; lane++) {
+            machines[backend][lane] = gameboy_create();
+            bus_set_rom_writable(&machines[backend][lane]->bus, 1);
+        }
+    }
+
+    backend_probes_init(&probes, coverage);
+}
+
+static void load(gameboy_t *gb, const uint8_t *state, const uint8_t *code, size_t code_size) {
+    cpu_t *cpu = &gb->cpu;
+
+    bus_clear(&gb->bus);
+    if (code_size > 0) bus_copy_in(&gb->bus, FUZZ_CODE_ADDRESS, code, code_size);
+
+    memset(cpu, 0, sizeof(cpu_t));
+    cpu->registers.w.A = state[0];
+    cpu->registers.w.F.w = state[1];
+    cpu->registers.w.B = state[2];
+    cpu->registers.w.C = state[3];
+    cpu->registers.w.D = state[4];
+    cpu->registers.w.E = state[5];
+    cpu->registers.w.H = state[6];
+    cpu->registers.w.L = state[7];
+    cpu->registers.dw.SP = state[8] | state[9] << 8;
+    cpu->registers.dw.PC = FUZZ_CODE_ADDRESS;
+    gb->cycles = 0;
+}
+
+static void report(backend_t backend, int lane, int step, const char *what, const backend_outcome_t *expected,
+                   const backend_outcome_t *actual) {
+    const backend_outcome_t *outcomes[2] = { expected, actual };
+
+    fprintf(stderr, "%s differs from tick in %s, lane %d after %d instructions\n", backend_names[backend], what, lane,
+            step);
+
+    for (int i = 0; i < 2; i++) {
+        const cpu_t *cpu = &outcomes[i]->cpu;
+
+        fprintf(stderr, "  %s: AF=%02x%02x BC=%04x DE=%04x HL=%04x SP=%04x PC=%04x halted=%d stopped=%d\n",
+                backend_names[i ? backend : BACKEND_TICK], cpu->registers.w.A, cpu->registers.w.F.w,
+                cpu->registers.dw.BC, cpu->registers.dw.DE, cpu->registers.dw.HL, cpu->registers.dw.SP,
+                cpu->registers.dw.PC, cpu->state.halted, cpu->state.stopped);
+    }
+
+    abort();
+}
+
+static void compare(int lanes, int step) {
+    for (int lane = 0; lane < lanes; lane++) {
+        backend_outcome_t expected;
+        backend_capture(machines[BACKEND_TICK][lane], &expected);
+
+        for (int backend = BACKEND_TICK + 1; backend < BACKEND_COUNT; backend++) {
+            backend_outcome_t actual;
+            backend_capture(machines[backend][lane], &actual);
+
+            const char *what = backend_compare(&actual, &expected);
+            if (what != NULL) report(backend, lane, step, what, &expected, &actual);
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static int ready = 0;
+    static const uint8_t blank_state[FUZZ_STATE_SIZE];
+
+    if (!ready) {
+        setup();
+        ready = 1;
+    }
+
+    if (size == 0) return 0;
+
+    int lanes = 1 + data[0] % FUZZ_LANES;
+    size_t offset = 1;
+    const uint8_t *states[FUZZ_LANES];
+
+    for (int lane = 0; lane < lanes; lane++) {
+        states[lane] = offset + FUZZ_STATE_SIZE <= size ? data + offset : blank_state;
+        offset += FUZZ_STATE_SIZE;
+    }
+
+    const uint8_t *code = offset < size ? data + offset : NULL;
+    size_t code_size = offset < size ? size - offset : 0;
+    if (code_size > FUZZ_CODE_MAX) code_size = FUZZ_CODE_MAX;
+
+    for (int backend = 0; backend < BACKEND_COUNT; backend++) {
+        for (int lane = 0; lane < lanes; lane++) {
+            load(machines[backend][lane], states[lane], code, code_size);
+        }
+    }
+
+    lockstep_init(&lockstep, machines[BACKEND_LANES], lanes);
+
+    for (int step = 0; step < FUZZ_STEPS;) {
+        for (int i = 0; i < FUZZ_BLOCK; i++, step++) {
+            for (int backend = 0; backend < BACKEND_LANES; backend++) {
+                for (int lane = 0; lane < lanes; lane++) {
+                    backend_execute(backend, machines[backend][lane], &probes);
+                }
+            }
+
+            lockstep_step_cpu(&lockstep);
+        }
+
+        compare(lanes, step);
+    }
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gameboy.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define STANDALONE_MAX_INPUT 512
+
+// Stands in for libFuzzer where clang isn't available. Replays the inputs given as files, or runs a number of random
+// inputs (10000 by default) without any coverage feedback.
+int main(int argc, char **argv) {
+    long iterations = 10000;
+
+    if (argc > 1 && strspn(argv[1], "0123456789") != strlen(argv[1])) {
+        for (int i = 1; i < argc; i++) {
+            size_t size;
+            uint8_t *data = gameboy_read_file(argv[i], &size);
+
+            if (data == NULL) {
+                fprintf(stderr, "Couldn't read %s\n", argv[i]);
+                return 1;
+            }
+
+            LLVMFuzzerTestOneInput(data, size);
+            free(data);
+        }
+
+        printf("%d inputs replayed\n", argc - 1);
+        return 0;
+    }
+
+    if (argc > 1) iterations = strtol(argv[1], NULL, 10);
+
+    uint8_t data[STANDALONE_MAX_INPUT];
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+    for (long i = 0; i < iterations; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        size_t size = 1 + state % STANDALONE_MAX_INPUT;
+
+        for (size_t j = 0; j < size; j++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            data[j] = (uint8_t) state;
+        }
+
+        LLVMFuzzerTestOneInput(data, size);
+    }
+
+    printf("%ld random inputs ok\n", iterations);
+    return 0;
+}
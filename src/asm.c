@@ -0,0 +1,800 @@
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "asm.h"
+#include "components/cpu.h"
+
+#define ASM_LINE_SIZE 256
+#define ASM_NAME_SIZE 64
+#define ASM_MAX_OPERANDS 16 // DB and DW lists, instructions have at most two.
+
+typedef struct {
+    char name[ASM_NAME_SIZE];
+    long value;
+} asm_symbol_t;
+
+typedef struct {
+    uint8_t *image;
+    size_t size;
+    long address;
+    long end;
+
+    int pass;
+    int line;
+    int unresolved; // Set when an expression in pass 1 used a symbol that isn't defined yet.
+
+    asm_symbol_t *symbols;
+    size_t count;
+    size_t capacity;
+    char scope[ASM_NAME_SIZE]; // Last global label, prefixed to .local ones.
+
+    asm_error_t *error;
+} assembler_t;
+
+typedef struct {
+    char text[ASM_LINE_SIZE];  // As written, trimmed. Expressions are evaluated from this.
+    char upper[ASM_LINE_SIZE]; // Upper case without blanks, [] turned into (). Matched against the op tables.
+} operand_t;
+
+static int fail(assembler_t *as, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    as->error->line = as->line;
+    vsnprintf(as->error->message, sizeof(as->error->message), format, args);
+
+    va_end(args);
+    return -1;
+}
+
+static int is_name_start(char c) {
+    return isalpha((unsigned char) c) || c == '_' || c == '.';
+}
+
+static int is_name_char(char c) {
+    return isalnum((unsigned char) c) || c == '_' || c == '.';
+}
+
+static char *trim(char *text) {
+    while (isspace((unsigned char) *text)) text++;
+
+    size_t length = strlen(text);
+    while (length > 0 && isspace((unsigned char) text[length - 1])) text[--length] = '\0';
+
+    return text;
+}
+
+// Expands .local names with the current scope.
+static int full_name(assembler_t *as, const char *name, size_t length, char *out) {
+    size_t prefix = name[0] == '.' ? strlen(as->scope) : 0;
+
+    if (prefix + length >= ASM_NAME_SIZE) return fail(as, "Name too long");
+
+    memcpy(out, as->scope, prefix);
+    memcpy(out + prefix, name, length);
+    out[prefix + length] = '\0';
+    return 0;
+}
+
+static asm_symbol_t *find_symbol(assembler_t *as, const char *name) {
+    for (size_t i = 0; i < as->count; i++) {
+        if (strcmp(as->symbols[i].name, name) == 0) return &as->symbols[i];
+    }
+
+    return NULL;
+}
+
+static int define_symbol(assembler_t *as, const char *name, long value) {
+    asm_symbol_t *symbol = find_symbol(as, name);
+
+    if (symbol != NULL) {
+        if (as->pass == 1) return fail(as, "%s is defined twice", name);
+
+        symbol->value = value;
+        return 0;
+    }
+
+    if (as->count == as->capacity) {
+        as->capacity = as->capacity ? as->capacity * 2 : 64;
+        as->symbols = realloc(as->symbols, as->capacity * sizeof(asm_symbol_t));
+    }
+
+    symbol = &as->symbols[as->count++];
+    strcpy(symbol->name, name);
+    symbol->value = value;
+    return 0;
+}
+
+static int parse_expression(assembler_t *as, const char **p, long *value);
+
+static void skip_blanks(const char **p) {
+    while (isspace((unsigned char) **p)) (*p)++;
+}
+
+static int parse_number(assembler_t *as, const char **p, long *value) {
+    const char *s = *p;
+    int base = 10;
+
+    if (*s == '$') {
+        base = 16;
+        s++;
+    } else if (*s == '%') {
+        base = 2;
+        s++;
+    } else if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    } else if (s[0] == '0' && (s[1] == 'b' || s[1] == 'B') && (s[2] == '0' || s[2] == '1')) {
+        base = 2;
+        s += 2;
+    }
+
+    char *end;
+    *value = strtol(s, &end, base);
+
+    if (end == s || is_name_char(*end)) return fail(as, "Invalid number");
+
+    *p = end;
+    return 0;
+}
+
+static int parse_primary(assembler_t *as, const char **p, long *value) {
+    skip_blanks(p);
+    const char *s = *p;
+
+    if (*s == '(') {
+        *p = s + 1;
+        if (parse_expression(as, p, value) != 0) return -1;
+
+        skip_blanks(p);
+        if (**p != ')') return fail(as, "Missing )");
+
+        (*p)++;
+        return 0;
+    }
+
+    if (*s == '-' || *s == '+' || *s == '~') {
+        *p = s + 1;
+        if (parse_primary(as, p, value) != 0) return -1;
+
+        if (*s == '-') *value = -*value;
+        if (*s == '~') *value = ~*value;
+        return 0;
+    }
+
+    if (*s == '@') {
+        *p = s + 1;
+        *value = as->address;
+        return 0;
+    }
+
+    if (*s == '\'' && s[1] != '\0' && s[2] == '\'') {
+        *p = s + 3;
+        *value = (unsigned char) s[1];
+        return 0;
+    }
+
+    if (isdigit((unsigned char) *s) || ((*s == '$' || *s == '%') && isxdigit((unsigned char) s[1]))) {
+        return parse_number(as, p, value);
+    }
+
+    if (!is_name_start(*s)) return fail(as, "Expected a value");
+
+    size_t length = 1;
+    while (is_name_char(s[length])) length++;
+
+    const char *after = s + length;
+    while (isspace((unsigned char) *after)) after++;
+
+    int high = length == 4 && strncasecmp(s, "HIGH", 4) == 0;
+    int low = length == 3 && strncasecmp(s, "LOW", 3) == 0;
+
+    if (*after == '(' && (high || low)) {
+        *p = after;
+        if (parse_primary(as, p, value) != 0) return -1;
+
+        *value = high ? *value >> 8 & 0xff : *value & 0xff;
+        return 0;
+    }
+
+    char name[ASM_NAME_SIZE];
+    if (full_name(as, s, length, name) != 0) return -1;
+
+    asm_symbol_t *symbol = find_symbol(as, name);
+    *p = s + length;
+
+    if (symbol != NULL) {
+        *value = symbol->value;
+    } else if (as->pass == 1) {
+        *value = 0;
+        as->unresolved = 1;
+    } else {
+        return fail(as, "Undefined symbol %s", name);
+    }
+
+    return 0;
+}
+
+// Binary operators by precedence, lowest first, as in C.
+static const char *const operators[][3] = {
+    { "|" }, { "^" }, { "&" }, { "<<", ">>" }, { "+", "-" }, { "*", "/", "%" },
+};
+
+static int parse_binary(assembler_t *as, const char **p, long *value, int level) {
+    if (level == sizeof(operators) / sizeof(operators[0])) return parse_primary(as, p, value);
+    if (parse_binary(as, p, value, level + 1) != 0) return -1;
+
+    for (;;) {
+        skip_blanks(p);
+
+        const char *op = NULL;
+        for (int i = 0; i < 3 && operators[level][i] != NULL; i++) {
+            size_t length = strlen(operators[level][i]);
+
+            // Keeps | from eating ||, & from &&, and < from <<.
+            if (strncmp(*p, operators[level][i], length) == 0 && (length == 2 || (*p)[1] != (*p)[0])) {
+                op = operators[level][i];
+            }
+        }
+
+        if (op == NULL) return 0;
+
+        long right;
+        *p += strlen(op);
+        if (parse_binary(as, p, &right, level + 1) != 0) return -1;
+
+        switch (op[0]) {
+            case '|': *value |= right; break;
+            case '^': *value ^= right; break;
+            case '&': *value &= right; break;
+            case '<': *value = (long) ((unsigned long) *value << (right & 63)); break;
+            case '>': *value >>= right & 63; break;
+            case '+': *value += right; break;
+            case '-': *value -= right; break;
+            case '*': *value *= right; break;
+
+            default: // '/' and '%'
+                if (right == 0) {
+                    if (as->pass == 1) {
+                        *value = 0;
+                        break;
+                    }
+
+                    return fail(as, "Division by zero");
+                }
+
+                *value = op[0] == '/' ? *value / right : *value % right;
+                break;
+        }
+    }
+}
+
+static int parse_expression(assembler_t *as, const char **p, long *value) {
+    return parse_binary(as, p, value, 0);
+}
+
+// Evaluates a whole operand, anything left over is an error.
+static int evaluate(assembler_t *as, const char *text, long *value) {
+    const char *p = text;
+
+    if (parse_expression(as, &p, value) != 0) return -1;
+
+    skip_blanks(&p);
+    if (*p != '\0') return fail(as, "Unexpected %s", p);
+
+    return 0;
+}
+
+// Like evaluate(), for values that decide the layout and so have to be known in pass 1.
+static int evaluate_now(assembler_t *as, const char *text, long *value) {
+    as->unresolved = 0;
+    if (evaluate(as, text, value) != 0) return -1;
+
+    return as->unresolved ? fail(as, "%s must not refer to later symbols", text) : 0;
+}
+
+static int emit(assembler_t *as, uint8_t byte) {
+    if (as->address < 0 || (size_t) as->address >= as->size) {
+        return fail(as, "Address $%04lx is outside the image", as->address & 0xffff);
+    }
+
+    if (as->pass == 2) as->image[as->address] = byte;
+
+    as->address++;
+    if (as->address > as->end) as->end = as->address;
+    return 0;
+}
+
+static int check_range(assembler_t *as, long value, long min, long max) {
+    if (as->pass == 2 && (value < min || value > max)) return fail(as, "Value %ld out of range", value);
+    return 0;
+}
+
+// Splits at top level commas. Quotes and brackets may contain commas.
+static int split_operands(assembler_t *as, char *text, operand_t *operands) {
+    int count = 0;
+    int depth = 0;
+    char quote = 0;
+    char *start = text;
+
+    if (*trim(text) == '\0') return 0;
+
+    for (char *c = text;; c++) {
+        if (quote) {
+            if (*c == quote) quote = 0;
+            if (*c != '\0') continue;
+        }
+
+        if (*c == '"' || *c == '\'') quote = *c;
+        if (*c == '(' || *c == '[') depth++;
+        if (*c == ')' || *c == ']') depth--;
+
+        if (*c == '\0' || (*c == ',' && depth == 0)) {
+            if (count == ASM_MAX_OPERANDS) return fail(as, "Too many operands");
+
+            int last = *c == '\0';
+            *c = '\0';
+
+            operand_t *operand = &operands[count++];
+            strcpy(operand->text, trim(start));
+
+            char *out = operand->upper;
+            for (const char *in = operand->text; *in; in++) {
+                if (isspace((unsigned char) *in)) continue;
+
+                *out++ = *in == '[' ? '(' : *in == ']' ? ')' : (char) toupper((unsigned char) *in);
+            }
+
+            *out = '\0';
+            if (operand->text[0] == '\0') return fail(as, "Empty operand");
+
+            if (last) break;
+            start = c + 1;
+        }
+    }
+
+    return count;
+}
+
+static int is_register(const char *upper) {
+    static const char *const names[] = {
+        "A", "F", "B", "C", "D", "E", "H", "L", "AF", "BC", "DE", "HL", "SP", "NZ", "Z", "NC", "HL+", "HL-",
+    };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(upper, names[i]) == 0) return 1;
+    }
+
+    return 0;
+}
+
+static int is_memory(const char *upper) {
+    size_t length = strlen(upper);
+    if (length < 2 || upper[0] != '(' || upper[length - 1] != ')') return 0;
+
+    // "(1+2)*(3)" starts and ends with a bracket too, the first one has to close last.
+    int depth = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (upper[i] == '(') depth++;
+        if (upper[i] == ')' && --depth == 0 && i != length - 1) return 0;
+    }
+
+    return 1;
+}
+
+// Rewrites the alternative spellings into the ones cpu_ops uses.
+static void normalize(char *mnemonic, operand_t *operands, int *count) {
+    for (int i = 0; i < *count; i++) {
+        char *upper = operands[i].upper;
+
+        if (strcmp(upper, "(HLI)") == 0) strcpy(upper, "(HL+)");
+        if (strcmp(upper, "(HLD)") == 0) strcpy(upper, "(HL-)");
+
+        if (strcmp(upper, "($FF00+C)") == 0 || strcmp(upper, "(0XFF00+C)") == 0) strcpy(upper, "(C)");
+
+        if ((strcmp(mnemonic, "LDI") == 0 || strcmp(mnemonic, "LDD") == 0) && strcmp(upper, "(HL)") == 0) {
+            strcpy(upper, mnemonic[2] == 'I' ? "(HL+)" : "(HL-)");
+        }
+    }
+
+    if (strcmp(mnemonic, "LDI") == 0 || strcmp(mnemonic, "LDD") == 0) strcpy(mnemonic, "LD");
+
+    if (strcmp(mnemonic, "LDH") == 0 && *count == 2
+        && (strcmp(operands[0].upper, "(C)") == 0 || strcmp(operands[1].upper, "(C)") == 0)) {
+        strcpy(mnemonic, "LD");
+    }
+
+    if (strcmp(mnemonic, "JP") == 0 && *count == 1 && strcmp(operands[0].upper, "HL") == 0) {
+        strcpy(operands[0].upper, "(HL)");
+    }
+
+    int accumulator_implied = strcmp(mnemonic, "SUB") == 0 || strcmp(mnemonic, "AND") == 0
+                              || strcmp(mnemonic, "XOR") == 0 || strcmp(mnemonic, "OR") == 0
+                              || strcmp(mnemonic, "CP") == 0;
+    int accumulator_named = strcmp(mnemonic, "ADD") == 0 || strcmp(mnemonic, "ADC") == 0
+                            || strcmp(mnemonic, "SBC") == 0;
+
+    if (accumulator_implied && *count == 2 && strcmp(operands[0].upper, "A") == 0) {
+        operands[0] = operands[1];
+        *count = 1;
+    } else if (accumulator_named && *count == 1) {
+        operands[1] = operands[0];
+        strcpy(operands[0].text, "A");
+        strcpy(operands[0].upper, "A");
+        *count = 2;
+    }
+}
+
+typedef enum {
+    VALUE_NONE,
+    VALUE_D8,
+    VALUE_D16,
+    VALUE_A8,
+    VALUE_R8, // Relative jump target.
+    VALUE_S8, // Signed SP offset.
+} value_kind_t;
+
+// Matches one operand against its pattern from the op table. On success *kind and *expression say which value the
+// operand supplies, if any.
+static int match_operand(assembler_t *as, const char *pattern, const operand_t *operand, const char *mnemonic,
+                         value_kind_t *kind, const char **expression, char *inner) {
+    const char *upper = operand->upper;
+    *kind = VALUE_NONE;
+
+    if (strcmp(pattern, "d8") == 0 || strcmp(pattern, "d16") == 0 || strcmp(pattern, "a16") == 0
+        || strcmp(pattern, "r8") == 0) {
+        if (is_register(upper) || is_memory(upper)) return 0;
+        if (strncmp(upper, "SP+", 3) == 0 || strncmp(upper, "SP-", 3) == 0) return 0;
+
+        *kind = pattern[0] == 'r' ? (strcmp(mnemonic, "JR") == 0 ? VALUE_R8 : VALUE_S8)
+                : pattern[1] == '8' ? VALUE_D8
+                : VALUE_D16;
+        *expression = operand->text;
+        return 1;
+    }
+
+    if (strcmp(pattern, "(a8)") == 0 || strcmp(pattern, "(a16)") == 0) {
+        if (!is_memory(upper)) return 0;
+
+        size_t length = strlen(upper);
+        char register_name[ASM_LINE_SIZE];
+        memcpy(register_name, upper + 1, length - 2);
+        register_name[length - 2] = '\0';
+
+        if (is_register(register_name)) return 0;
+
+        // The original text minus its brackets.
+        size_t text_length = strlen(operand->text);
+        memcpy(inner, operand->text + 1, text_length - 2);
+        inner[text_length - 2] = '\0';
+
+        *kind = pattern[2] == '8' ? VALUE_A8 : VALUE_D16;
+        *expression = inner;
+        return 1;
+    }
+
+    if (strcmp(pattern, "SP+r8") == 0) {
+        if (strncmp(upper, "SP+", 3) != 0 && strncmp(upper, "SP-", 3) != 0) return 0;
+
+        const char *text = operand->text;
+        while (*text && toupper((unsigned char) *text) != 'P') text++;
+
+        *kind = VALUE_S8;
+        *expression = text + 1;
+        return 1;
+    }
+
+    // BIT, RES and SET take their bit number as an expression.
+    if (isdigit((unsigned char) pattern[0]) && pattern[1] == '\0') {
+        if (is_register(upper) || is_memory(upper)) return 0;
+
+        long value;
+        as->unresolved = 0;
+        if (evaluate(as, operand->text, &value) != 0) return -1;
+
+        return as->unresolved || value == pattern[0] - '0';
+    }
+
+    return strcmp(pattern, upper) == 0;
+}
+
+static int emit_value(assembler_t *as, value_kind_t kind, const char *expression, long instruction) {
+    long value;
+
+    if (kind == VALUE_NONE) return 0;
+    if (evaluate(as, expression, &value) != 0) return -1;
+
+    switch (kind) {
+        case VALUE_D8:
+            if (check_range(as, value, -128, 255) != 0) return -1;
+            return emit(as, value & 0xff);
+        case VALUE_A8:
+            if (value >= 0xff00 && value <= 0xffff) value -= 0xff00;
+            if (check_range(as, value, 0, 255) != 0) return -1;
+            return emit(as, value & 0xff);
+        case VALUE_D16:
+            if (check_range(as, value, -32768, 65535) != 0) return -1;
+            if (emit(as, value & 0xff) != 0) return -1;
+            return emit(as, value >> 8 & 0xff);
+        case VALUE_R8:
+            value -= instruction + 2;
+            if (check_range(as, value, -128, 127) != 0) return -1;
+            return emit(as, value & 0xff);
+        case VALUE_S8:
+            if (check_range(as, value, -128, 127) != 0) return -1;
+            return emit(as, value & 0xff);
+
+        default: return 0;
+    }
+}
+
+static int assemble_instruction(assembler_t *as, char *mnemonic, operand_t *operands, int count) {
+    for (char *c = mnemonic; *c; c++) *c = (char) toupper((unsigned char) *c);
+    normalize(mnemonic, operands, &count);
+
+    if (strcmp(mnemonic, "RST") == 0) {
+        long target;
+
+        if (count != 1) return fail(as, "RST takes one operand");
+        if (evaluate(as, operands[0].text, &target) != 0) return -1;
+        if (as->pass == 2 && (target < 0 || target > 0x38 || target % 8 != 0)) return fail(as, "Invalid RST target");
+
+        return emit(as, 0xc7 + (target & 0x38));
+    }
+
+    int known = 0;
+
+    for (int prefix = 0; prefix < 2; prefix++) {
+        const op_t *table = prefix ? cpu_cb_ops : cpu_ops;
+
+        for (int i = 0; i < 256; i++) {
+            const char *name = table[i].name;
+            if (name == NULL || (!prefix && (i == 0xcb || (i & 0xc7) == 0xc7))) continue; // RST is handled above.
+
+            size_t length = strcspn(name, " ");
+            if (strlen(mnemonic) != length || strncmp(name, mnemonic, length) != 0) continue;
+            known = 1;
+
+            char patterns[ASM_LINE_SIZE];
+            char *pattern_list[ASM_MAX_OPERANDS];
+            int pattern_count = 0;
+
+            strcpy(patterns, name + length);
+            for (char *token = trim(patterns); *token != '\0' && pattern_count < ASM_MAX_OPERANDS;) {
+                pattern_list[pattern_count++] = token;
+
+                char *comma = strchr(token, ',');
+                if (comma == NULL) break;
+
+                *comma = '\0';
+                token = comma + 1;
+            }
+
+            if (pattern_count != count) continue;
+
+            value_kind_t kinds[ASM_MAX_OPERANDS];
+            const char *expressions[ASM_MAX_OPERANDS];
+            char inner[ASM_MAX_OPERANDS][ASM_LINE_SIZE];
+            int matched = 1;
+
+            for (int j = 0; j < count && matched; j++) {
+                matched = match_operand(as, pattern_list[j], &operands[j], mnemonic, &kinds[j], &expressions[j],
+                                        inner[j]);
+                if (matched < 0) return -1;
+            }
+
+            if (!matched) continue;
+
+            long start = as->address;
+            if (prefix && emit(as, 0xcb) != 0) return -1;
+            if (emit(as, i) != 0) return -1;
+
+            for (int j = 0; j < count; j++) {
+                if (emit_value(as, kinds[j], expressions[j], start) != 0) return -1;
+            }
+
+            // STOP is followed by a padding byte.
+            while (as->address < start + table[i].length) {
+                if (emit(as, 0x00) != 0) return -1;
+            }
+
+            return 0;
+        }
+    }
+
+    return known ? fail(as, "Invalid operands for %s", mnemonic) : fail(as, "Unknown instruction %s", mnemonic);
+}
+
+static int assemble_data(assembler_t *as, const char *directive, operand_t *operands, int count) {
+    if (strcasecmp(directive, "DS") == 0) {
+        long size;
+        long fill = 0;
+
+        if (count < 1 || count > 2) return fail(as, "DS takes a size and an optional fill byte");
+        if (evaluate_now(as, operands[0].text, &size) != 0) return -1;
+        if (count == 2 && evaluate(as, operands[1].text, &fill) != 0) return -1;
+        if (size < 0) return fail(as, "Negative size");
+
+        for (long i = 0; i < size; i++) {
+            if (emit(as, fill & 0xff) != 0) return -1;
+        }
+
+        return 0;
+    }
+
+    int words = strcasecmp(directive, "DW") == 0;
+
+    for (int i = 0; i < count; i++) {
+        const char *text = operands[i].text;
+        size_t length = strlen(text);
+
+        if (!words && length >= 2 && text[0] == '"' && text[length - 1] == '"') {
+            for (size_t j = 1; j < length - 1; j++) {
+                if (emit(as, (uint8_t) text[j]) != 0) return -1;
+            }
+
+            continue;
+        }
+
+        long value;
+        if (evaluate(as, text, &value) != 0) return -1;
+
+        if (words) {
+            if (check_range(as, value, -32768, 65535) != 0) return -1;
+            if (emit(as, value & 0xff) != 0 || emit(as, value >> 8 & 0xff) != 0) return -1;
+        } else {
+            if (check_range(as, value, -128, 255) != 0) return -1;
+            if (emit(as, value & 0xff) != 0) return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int assemble_line(assembler_t *as, char *line) {
+    char quote = 0;
+
+    for (char *c = line; *c; c++) { // Cuts the comment, unless the ';' is quoted.
+        if (quote) {
+            if (*c == quote) quote = 0;
+        } else if (*c == '"' || *c == '\'') {
+            quote = *c;
+        } else if (*c == ';') {
+            *c = '\0';
+            break;
+        }
+    }
+
+    char *p = trim(line);
+
+    if (is_name_start(*p)) {
+        size_t length = 1;
+        while (is_name_char(p[length])) length++;
+
+        if (p[length] == ':') {
+            char name[ASM_NAME_SIZE];
+            if (full_name(as, p, length, name) != 0) return -1;
+            if (p[0] != '.') strcpy(as->scope, name);
+            if (define_symbol(as, name, as->address) != 0) return -1;
+
+            p = trim(p + length + 1 + (p[length + 1] == ':'));
+        }
+    }
+
+    if (*p == '\0') return 0;
+
+    char *word = p;
+    while (*p && !isspace((unsigned char) *p)) p++;
+    if (*p) *p++ = '\0';
+    p = trim(p);
+
+    // NAME EQU expr
+    if (strncasecmp(p, "EQU", 3) == 0 && (p[3] == '\0' || isspace((unsigned char) p[3]))) {
+        char name[ASM_NAME_SIZE];
+        long value;
+
+        if (!is_name_start(word[0])) return fail(as, "Invalid name %s", word);
+        if (full_name(as, word, strlen(word), name) != 0) return -1;
+        if (evaluate(as, trim(p + 3), &value) != 0) return -1;
+
+        return define_symbol(as, name, value);
+    }
+
+    operand_t operands[ASM_MAX_OPERANDS];
+    int count = split_operands(as, p, operands);
+    if (count < 0) return -1;
+
+    if (strcasecmp(word, "ORG") == 0) {
+        long address;
+
+        if (count != 1) return fail(as, "ORG takes one address");
+        if (evaluate_now(as, operands[0].text, &address) != 0) return -1;
+
+        as->address = address;
+        return 0;
+    }
+
+    if (strcasecmp(word, "DB") == 0 || strcasecmp(word, "DW") == 0 || strcasecmp(word, "DS") == 0) {
+        return assemble_data(as, word, operands, count);
+    }
+
+    return assemble_instruction(as, word, operands, count);
+}
+
+long asm_assemble(const char *source, uint8_t *image, size_t size, asm_error_t *error) {
+    assembler_t as;
+    memset(&as, 0, sizeof(as));
+
+    as.image = image;
+    as.size = size;
+    as.error = error;
+    error->line = 0;
+    error->message[0] = '\0';
+
+    int status = 0;
+
+    for (as.pass = 1; as.pass <= 2 && status == 0; as.pass++) {
+        const char *line = source;
+
+        as.address = 0;
+        as.end = 0;
+        as.line = 0;
+        as.scope[0] = '\0';
+
+        while (*line && status == 0) {
+            size_t length = strcspn(line, "\n");
+            char buffer[ASM_LINE_SIZE];
+
+            as.line++;
+
+            if (length >= sizeof(buffer)) {
+                status = fail(&as, "Line too long");
+                break;
+            }
+
+            memcpy(buffer, line, length);
+            buffer[length] = '\0';
+            status = assemble_line(&as, buffer);
+
+            line += length;
+            if (*line == '\n') line++;
+        }
+    }
+
+    free(as.symbols);
+    return status == 0 ? as.end : -1;
+}
+
+long asm_assemble_file(const char *path, uint8_t *image, size_t size, asm_error_t *error) {
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) {
+        error->line = 0;
+        snprintf(error->message, sizeof(error->message), "Couldn't read %s", path);
+        return -1;
+    }
+
+    size_t capacity = 4096;
+    size_t length = 0;
+    char *source = malloc(capacity);
+
+    for (size_t read; (read = fread(source + length, 1, capacity - length - 1, file)) > 0;) {
+        length += read;
+
+        if (length == capacity - 1) {
+            capacity *= 2;
+            source = realloc(source, capacity);
+        }
+    }
+
+    fclose(file);
+    source[length] = '\0';
+
+    long result = asm_assemble(source, image, size, error);
+    free(source);
+    return result;
+}
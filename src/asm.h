@@ -0,0 +1,28 @@
+#ifndef CGAMEBOY_ASM_H
+#define CGAMEBOY_ASM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    int line;
+    char message[128];
+} asm_error_t;
+
+// Two pass SM83 assembler for small test programs, RGBDS flavoured. One statement per line, ';' starts a comment.
+//
+//   label:  .local:  NAME EQU expr
+//   ORG expr  DB expr|"text",...  DW expr,...  DS count[,fill]
+//
+// Mnemonics and operands are looked up in cpu_ops/cpu_cb_ops, so anything named there assembles. Memory operands
+// take [] or (), HLI/HLD and LDI/LDD are accepted for HL+/HL-. Expressions know + - * / % & | ^ << >> ~, HIGH(),
+// LOW(), @ for the current address, and $ff, 0xff, %1010, 0b1010 and 'c' literals.
+//
+// Assembles into image, which covers addresses 0 to size - 1 and should be zero-filled beforehand. Returns the number
+// of bytes up to the highest address written, or -1 with error filled in.
+long asm_assemble(const char *source, uint8_t *image, size_t size, asm_error_t *error);
+
+// Same for a file, error->line is 0 if the file couldn't be read.
+long asm_assemble_file(const char *path, uint8_t *image, size_t size, asm_error_t *error);
+
+#endif //CGAMEBOY_ASM_H
@@ -0,0 +1,60 @@
+#include <string.h>
+
+#include "backend.h"
+
+const char *const backend_names[BACKEND_COUNT] = { "tick", "coverage", "calls", "coverage_calls", "lanes" };
+
+static void on_call(void *ctx, uint16_t target, uint16_t return_address) {
+    (void) ctx;
+    (void) target;
+    (void) return_address;
+}
+
+static void on_return(void *ctx, uint16_t target) {
+    (void) ctx;
+    (void) target;
+}
+
+void backend_probes_init(cpu_probes_t *probes, uint8_t *coverage) {
+    memset(probes, 0, sizeof(cpu_probes_t));
+    probes->coverage = coverage;
+    probes->on_call = on_call;
+    probes->on_return = on_return;
+}
+
+void backend_execute(backend_t backend, gameboy_t *gb, cpu_probes_t *probes) {
+    if (gb->cpu.state.halted || gb->cpu.state.stopped) return;
+
+    uint16_t pc = gb->cpu.registers.dw.PC;
+    uint8_t opcode = bus_read(&gb->bus, pc);
+
+    gb->cycles += opcode == 0xcb ? cpu_cb_ops[bus_read(&gb->bus, pc + 1)].timing : cpu_ops[opcode].timing;
+
+    switch (backend) {
+        case BACKEND_COVERAGE: cpu_tick_coverage(&gb->cpu, &gb->bus, probes); break;
+        case BACKEND_CALLS: cpu_tick_calls(&gb->cpu, &gb->bus, probes); break;
+        case BACKEND_COVERAGE_CALLS: cpu_tick_coverage_calls(&gb->cpu, &gb->bus, probes); break;
+        default: cpu_tick(&gb->cpu, &gb->bus); break;
+    }
+}
+
+void backend_capture(gameboy_t *gb, backend_outcome_t *outcome) {
+    bus_fingerprint(&gb->bus, outcome->root);
+
+    outcome->cpu = gb->cpu;
+    outcome->cycles = gb->cycles;
+}
+
+const char *backend_compare(const backend_outcome_t *a, const backend_outcome_t *b) {
+    if (memcmp(&a->cpu.registers, &b->cpu.registers, sizeof(a->cpu.registers)) != 0) return "registers";
+
+    if (a->cpu.state.IME != b->cpu.state.IME || a->cpu.state.halted != b->cpu.state.halted
+        || a->cpu.state.stopped != b->cpu.state.stopped) {
+        return "CPU state";
+    }
+
+    if (a->cycles != b->cycles) return "cycles";
+    if (a->root[0] != b->root[0] || a->root[1] != b->root[1]) return "memory";
+
+    return NULL;
+}
@@ -0,0 +1,41 @@
+#ifndef CGAMEBOY_BACKEND_H
+#define CGAMEBOY_BACKEND_H
+
+#include <stdint.h>
+
+#include "gameboy.h"
+
+// The interpreter backends that have to behave exactly like cpu_tick(), shared by the test-vector runner and the CPU
+// fuzzer. The scalar ones step one instance through backend_execute(), the lanes step all of theirs at once through
+// lockstep_step_cpu().
+typedef enum {
+    BACKEND_TICK,
+    BACKEND_COVERAGE,
+    BACKEND_CALLS,
+    BACKEND_COVERAGE_CALLS,
+    BACKEND_LANES,
+    BACKEND_COUNT,
+} backend_t;
+
+extern const char *const backend_names[BACKEND_COUNT];
+
+// What a backend left behind, memory only as its fingerprint.
+typedef struct {
+    cpu_t cpu;
+    uint64_t cycles;
+    uint64_t root[2];
+} backend_outcome_t;
+
+// Probes with every hook set to a no-op, so the probed instantiations take all of their paths.
+void backend_probes_init(cpu_probes_t *probes, uint8_t *coverage);
+
+// Runs one instruction on a scalar backend with the same cycle accounting as lockstep_step_cpu(). Halted and stopped
+// CPUs are left alone.
+void backend_execute(backend_t backend, gameboy_t *gb, cpu_probes_t *probes);
+
+void backend_capture(gameboy_t *gb, backend_outcome_t *outcome);
+
+// Returns the first part that differs ("registers", "CPU state", "cycles" or "memory"), or NULL if none does.
+const char *backend_compare(const backend_outcome_t *a, const backend_outcome_t *b);
+
+#endif //CGAMEBOY_BACKEND_H
@@ -0,0 +1,163 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "bootcache.h"
+#include "gameboy.h"
+#include "input.h"
+#include "pool.h"
+#include "timeline.h"
+
+typedef struct batch batch_t;
+
+typedef struct {
+    batch_t *batch;
+    char rom_path[256];
+    char input_path[256];
+    uint64_t frames;
+
+    int failed;
+    uint64_t hash;
+} job_t;
+
+// Per-thread state. The last loaded ROM stays booted, every job runs on a copy-on-write clone of it.
+typedef struct {
+    gameboy_t *boot;
+    char rom_path[256];
+    uint8_t *rom;
+    size_t rom_size;
+
+    cpu_probes_t probes;
+} worker_t;
+
+struct batch {
+    job_t *jobs;
+    size_t job_count;
+    worker_t *workers;
+    int profile;
+};
+
+static void run_job(void *arg, int worker_id) {
+    job_t *job = arg;
+    worker_t *worker = &job->batch->workers[worker_id];
+
+    if (worker->rom == NULL || strcmp(worker->rom_path, job->rom_path) != 0) {
+        free(worker->rom);
+        worker->rom = gameboy_read_file(job->rom_path, &worker->rom_size);
+        strcpy(worker->rom_path, job->rom_path);
+
+        if (worker->rom == NULL) {
+            job->failed = 1;
+            return;
+        }
+
+        if (worker->boot == NULL) worker->boot = gameboy_create();
+        bootcache_reset(worker->boot, worker->rom, worker->rom_size);
+
+        if (job->batch->profile) {
+            if (worker->probes.profile == NULL) worker->probes.profile = profile_create();
+            gameboy_set_probes(worker->boot, &worker->probes);
+        }
+    }
+
+    input_script_t script = { NULL, 0 };
+    if (job->input_path[0] && input_script_load(&script, job->input_path) != 0) {
+        job->failed = 1;
+        return;
+    }
+
+    uint64_t begin = timeline_begin();
+    gameboy_t *gb = gameboy_clone(worker->boot);
+
+    input_script_run(&script, gb, job->frames);
+    job->hash = gameboy_hash(gb);
+    timeline_end("job", begin);
+
+    gameboy_destroy(gb);
+    input_script_free(&script);
+}
+
+static int load_jobs(batch_t *batch, const char *job_list) {
+    FILE *file = fopen(job_list, "r");
+    if (file == NULL) return -1;
+
+    size_t capacity = 0;
+    char line[1024];
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+
+        job_t job;
+        unsigned long long frames;
+        memset(&job, 0, sizeof(job));
+
+        int fields = sscanf(line, "%255s %llu %255s", job.rom_path, &frames, job.input_path);
+        if (fields <= 0) continue;
+
+        if (fields < 2) {
+            fclose(file);
+            return -1;
+        }
+
+        job.batch = batch;
+        job.frames = frames;
+
+        if (batch->job_count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            batch->jobs = realloc(batch->jobs, capacity * sizeof(job_t));
+        }
+
+        batch->jobs[batch->job_count++] = job;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+int batch_run(const char *job_list, int threads, FILE *out, profile_t *profile) {
+    batch_t batch = { NULL, 0, NULL, profile != NULL };
+
+    if (load_jobs(&batch, job_list) != 0) {
+        free(batch.jobs);
+        return -1;
+    }
+
+    pool_t *pool = pool_create(threads);
+    batch.workers = calloc(pool_size(pool), sizeof(worker_t));
+
+    for (size_t i = 0; i < batch.job_count; i++) {
+        pool_submit(pool, run_job, &batch.jobs[i]);
+    }
+
+    pool_wait(pool);
+
+    int failures = 0;
+    for (size_t i = 0; i < batch.job_count; i++) {
+        job_t *job = &batch.jobs[i];
+
+        if (job->failed) {
+            fprintf(out, "%s failed\n", job->rom_path);
+            failures++;
+        } else {
+            fprintf(out, "%s %016" PRIx64 "\n", job->rom_path, job->hash);
+        }
+    }
+
+    for (int i = 0; i < pool_size(pool); i++) {
+        if (profile != NULL && batch.workers[i].probes.profile != NULL) {
+            profile_merge(profile, batch.workers[i].probes.profile);
+        }
+
+        gameboy_destroy(batch.workers[i].boot);
+        profile_destroy(batch.workers[i].probes.profile);
+        free(batch.workers[i].rom);
+    }
+
+    pool_destroy(pool);
+    free(batch.workers);
+    free(batch.jobs);
+
+    return failures ? -1 : 0;
+}
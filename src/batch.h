@@ -0,0 +1,13 @@
+#ifndef CGAMEBOY_BATCH_H
+#define CGAMEBOY_BATCH_H
+
+#include <stdio.h>
+
+#include "profile.h"
+
+// Runs every job of a job list on a work-stealing pool and prints "<rom> <hash>" per job, in job list order.
+// Job list format, one job per line: "<rom> <frames> [input script]". '#' starts a comment. If profile isn't NULL,
+// every worker profiles into its own counters and they're added to it at the end.
+int batch_run(const char *job_list, int threads, FILE *out, profile_t *profile);
+
+#endif //CGAMEBOY_BATCH_H
@@ -0,0 +1,125 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bootcache.h"
+#include "savestate.h"
+#include "timeline.h"
+
+static int cache_dir(char *dir, size_t size) {
+    const char *env = getenv("CGB_CACHE_DIR");
+    if (env == NULL || env[0] == '\0') return -1;
+
+    int length = snprintf(dir, size, "%s", env);
+    return length > 0 && (size_t) length < size ? 0 : -1;
+}
+
+// Creates every missing component of dir.
+static int make_dirs(char *dir) {
+    for (char *slash = strchr(dir + 1, '/');; slash = strchr(slash + 1, '/')) {
+        if (slash != NULL) *slash = '\0';
+
+        int status = mkdir(dir, 0755);
+
+        if (slash != NULL) *slash = '/';
+        if (status != 0 && errno != EEXIST) return -1;
+        if (slash == NULL) return 0;
+    }
+}
+
+int bootcache_path(const uint8_t *rom, size_t rom_size, char *path, size_t size) {
+    char dir[PATH_MAX];
+    if (cache_dir(dir, sizeof(dir)) != 0) return -1;
+
+    unsigned header_checksum = rom_size > 0x14d ? rom[0x14d] : 0;
+    unsigned global_checksum = rom_size > 0x14f ? rom[0x14e] << 8 | rom[0x14f] : 0;
+
+    int length = snprintf(path, size, "%s/%02x-%04x-%zx.v%d.state", dir, header_checksum, global_checksum, rom_size,
+                          SAVESTATE_VERSION);
+    return length > 0 && (size_t) length < size ? 0 : -1;
+}
+
+static int load(gameboy_t *gb, const char *path, const uint8_t *rom, size_t rom_size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat info;
+    size_t size = savestate_size();
+
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size != size) {
+        close(fd);
+        return -1;
+    }
+
+    const uint8_t *state = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (state == MAP_FAILED) return -1;
+
+    // The key is only 3 bytes of header plus the size, so make sure the snapshot was really built from this ROM.
+    int status = -1;
+    if (memcmp(state + sizeof(savestate_header_t), rom, rom_size) == 0) {
+        status = savestate_load(gb, state, size);
+    }
+
+    munmap((void *) state, size);
+    return status;
+}
+
+// Writes to a temporary file first so concurrent launches never see a partial snapshot. Paths that don't fit are
+// skipped, a truncated name could rename the wrong file.
+static void store(const gameboy_t *gb, const char *path) {
+    char dir[PATH_MAX];
+    char temp[PATH_MAX];
+
+    int length = snprintf(dir, sizeof(dir), "%s", path);
+    if (length <= 0 || (size_t) length >= sizeof(dir)) return;
+
+    *strrchr(dir, '/') = '\0';
+    if (make_dirs(dir) != 0) return;
+
+    length = snprintf(temp, sizeof(temp), "%s.%ld.tmp", path, (long) getpid());
+    if (length <= 0 || (size_t) length >= sizeof(temp)) return;
+
+    FILE *file = fopen(temp, "wb");
+    if (file == NULL) return;
+
+    uint8_t *state = malloc(savestate_size());
+    savestate_save(gb, state);
+
+    int ok = fwrite(state, 1, savestate_size(), file) == savestate_size();
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(temp, path) != 0) remove(temp);
+    free(state);
+}
+
+static int reset(gameboy_t *gb, const uint8_t *rom, size_t rom_size) {
+    char path[PATH_MAX];
+
+    if (rom_size > GAMEBOY_ROM_SIZE) rom_size = GAMEBOY_ROM_SIZE;
+
+    if (rom == NULL || bootcache_path(rom, rom_size, path, sizeof(path)) != 0) {
+        gameboy_reset(gb, rom, rom_size);
+        return 0;
+    }
+
+    if (load(gb, path, rom, rom_size) == 0) return 1;
+
+    gameboy_reset(gb, rom, rom_size);
+    store(gb, path);
+    return 0;
+}
+
+int bootcache_reset(gameboy_t *gb, const uint8_t *rom, size_t rom_size) {
+    uint64_t begin = timeline_begin();
+    int cached = reset(gb, rom, rom_size);
+
+    timeline_end("boot", begin);
+    return cached;
+}
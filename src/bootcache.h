@@ -0,0 +1,18 @@
+#ifndef CGAMEBOY_BOOTCACHE_H
+#define CGAMEBOY_BOOTCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "gameboy.h"
+
+// On-disk post-boot snapshots, one save state per ROM, named after the header checksum, the global checksum and the
+// ROM size, in $CGB_CACHE_DIR. Without a boot ROM the post-boot state is built from a table in a few microseconds,
+// which is faster than mapping a snapshot, so the cache is off unless that variable is set.
+int bootcache_path(const uint8_t *rom, size_t rom_size, char *path, size_t size);
+
+// Same result as gameboy_reset(). Returns 1 if the state was mapped from the cache, 0 if it had to be built, in which
+// case it's written back for the next launch. A snapshot whose ROM image differs from rom is never used.
+int bootcache_reset(gameboy_t *gb, const uint8_t *rom, size_t rom_size);
+
+#endif //CGAMEBOY_BOOTCACHE_H
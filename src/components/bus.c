@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bus.h"
+
+static bus_chunk_t *chunk_create(void) {
+    bus_chunk_t *chunk = malloc(sizeof(bus_chunk_t));
+    atomic_init(&chunk->refs, 1);
+
+    return chunk;
+}
+
+static void chunk_release(bus_chunk_t *chunk) {
+    if (atomic_fetch_sub_explicit(&chunk->refs, 1, memory_order_acq_rel) == 1) {
+        free(chunk);
+    }
+}
+
+static void map_chunk(bus_t *bus, int index, bus_chunk_t *chunk, int writable) {
+    bus->chunks[index] = chunk;
+
+    for (int i = 0; i < BUS_CHUNK_PAGES; i++) {
+        int page = index * BUS_CHUNK_PAGES + i;
+
+        bus->read[page] = chunk->data + i * BUS_PAGE_SIZE;
+        bus->write[page] = writable && bus->dirty[page] && (page >= BUS_ROM_PAGES || bus->rom_writable)
+                           && (bus->trap[page] == NULL || bus->trap[page]->writes == 0)
+                           ? bus->read[page]
+                           : NULL;
+    }
+}
+
+// Makes sure the chunk has no other owner, copying it if needed.
+static bus_chunk_t *own_chunk(bus_t *bus, int index) {
+    bus_chunk_t *chunk = bus->chunks[index];
+
+    if (atomic_load_explicit(&chunk->refs, memory_order_acquire) != 1) {
+        bus_chunk_t *copy = chunk_create();
+        memcpy(copy->data, chunk->data, BUS_CHUNK_SIZE);
+
+        chunk_release(chunk);
+        chunk = copy;
+    }
+
+    map_chunk(bus, index, chunk, 1);
+    return chunk;
+}
+
+static inline uint64_t mix(uint64_t x) {
+    x = (x ^ x >> 30) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ x >> 27) * 0x94d049bb133111ebULL;
+    return x ^ x >> 31;
+}
+
+static uint64_t hash_page(const uint8_t *data) {
+    uint64_t hash = 0;
+
+    for (int i = 0; i < BUS_PAGE_SIZE; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 29;
+    }
+
+    return mix(hash);
+}
+
+// The root combines every (page, hash) pair order-independently, so replacing one page hash is O(1).
+static void root_update(bus_t *bus, int page, uint64_t hash, int add) {
+    uint64_t key = hash ^ (uint64_t) page * 0x9e3779b97f4a7c15ULL;
+    uint64_t second = mix(key ^ 0x5bd1e9955bd1e995ULL);
+
+    bus->root[0] ^= mix(key);
+    bus->root[1] += add ? second : -second;
+}
+
+static void check_write(bus_t *bus, uint16_t address) {
+    const bus_trap_t *trap = bus->trap[address >> 8];
+
+    if (trap != NULL && trap->write[(address & 0xff) >> 3] >> (address & 7) & 1 && !bus->trap_hit) {
+        bus->trap_hit = 1;
+        bus->trap_address = address;
+    }
+}
+
+static void mark_dirty(bus_t *bus, size_t address, size_t end) {
+    for (size_t page = address >> 8; page < BUS_PAGE_COUNT && page << 8 < end; page++) {
+        bus->dirty[page] = 1;
+    }
+}
+
+void bus_init(bus_t *bus) {
+    bus->root[0] = 0;
+    bus->root[1] = 0;
+
+    memset(bus->trap, 0, sizeof(bus->trap));
+    bus->trap_hit = 0;
+    bus->rom_writable = 0;
+
+    for (int i = 0; i < BUS_PAGE_COUNT; i++) {
+        bus->dirty[i] = 1;
+        bus->page_hash[i] = 0;
+        root_update(bus, i, 0, 1);
+    }
+
+    for (int i = 0; i < BUS_CHUNK_COUNT; i++) {
+        bus_chunk_t *chunk = chunk_create();
+        memset(chunk->data, 0, BUS_CHUNK_SIZE);
+
+        map_chunk(bus, i, chunk, 1);
+    }
+
+    bus->sink = 0;
+}
+
+void bus_free(bus_t *bus) {
+    for (int i = 0; i < BUS_CHUNK_COUNT; i++) {
+        chunk_release(bus->chunks[i]);
+        bus->chunks[i] = NULL;
+    }
+
+    memset(bus->read, 0, sizeof(bus->read));
+    memset(bus->write, 0, sizeof(bus->write));
+}
+
+void bus_clone(bus_t *dst, bus_t *src) {
+    for (int i = 0; i < BUS_CHUNK_COUNT; i++) {
+        atomic_fetch_add_explicit(&src->chunks[i]->refs, 1, memory_order_relaxed);
+        dst->chunks[i] = src->chunks[i];
+    }
+
+    memcpy(dst->read, src->read, sizeof(dst->read));
+    memcpy(dst->dirty, src->dirty, sizeof(dst->dirty));
+    memcpy(dst->page_hash, src->page_hash, sizeof(dst->page_hash));
+    memcpy(dst->root, src->root, sizeof(dst->root));
+    memset(dst->write, 0, sizeof(dst->write));
+    memset(src->write, 0, sizeof(src->write));
+    memcpy(dst->trap, src->trap, sizeof(dst->trap));
+    dst->trap_hit = 0;
+    dst->rom_writable = src->rom_writable;
+    dst->sink = 0;
+}
+
+void bus_set_trap(bus_t *bus, int page, const bus_trap_t *trap) {
+    bus->trap[page] = trap;
+
+    // Taken again on the next write if the page is still allowed to have one.
+    bus->write[page] = NULL;
+}
+
+void bus_set_rom_writable(bus_t *bus, int writable) {
+    bus->rom_writable = writable;
+
+    // Write pointers come back through bus_write_slow(), or not at all if the ROM is read-only again.
+    memset(bus->write, 0, BUS_ROM_PAGES * sizeof(bus->write[0]));
+}
+
+void bus_write_slow(bus_t *bus, uint16_t address, uint8_t value) {
+    int page = address >> 8;
+
+    check_write(bus, address);
+    if (page < BUS_ROM_PAGES && !bus->rom_writable) return; // No MBC yet, ROM writes go nowhere.
+
+    bus->dirty[page] = 1;
+    own_chunk(bus, page / BUS_CHUNK_PAGES);
+    bus->read[page][address & 0xff] = value;
+}
+
+// For read-modify-write operands. ROM addresses get a scratch byte holding the current value, so the write is lost.
+uint8_t *bus_write_ptr(bus_t *bus, uint16_t address) {
+    int page = address >> 8;
+
+    if (bus->write[page] == NULL) {
+        check_write(bus, address);
+
+        if (page < BUS_ROM_PAGES && !bus->rom_writable) {
+            bus->sink = bus_read(bus, address);
+            return &bus->sink;
+        }
+
+        bus->dirty[page] = 1;
+        own_chunk(bus, page / BUS_CHUNK_PAGES);
+    }
+
+    return &bus->read[page][address & 0xff];
+}
+
+void bus_clear(bus_t *bus) {
+    for (int i = 0; i < BUS_CHUNK_COUNT; i++) {
+        memset(own_chunk(bus, i)->data, 0, BUS_CHUNK_SIZE);
+    }
+
+    mark_dirty(bus, 0, BUS_CHUNK_COUNT * BUS_CHUNK_SIZE);
+}
+
+void bus_copy_in(bus_t *bus, uint16_t address, const uint8_t *src, size_t size) {
+    size_t end = (size_t) address + size;
+    if (end > BUS_CHUNK_COUNT * BUS_CHUNK_SIZE) end = BUS_CHUNK_COUNT * BUS_CHUNK_SIZE;
+
+    for (size_t pos = address; pos < end;) {
+        size_t offset = pos % BUS_CHUNK_SIZE;
+        size_t chunk = BUS_CHUNK_SIZE - offset < end - pos ? BUS_CHUNK_SIZE - offset : end - pos;
+
+        memcpy(own_chunk(bus, (int) (pos / BUS_CHUNK_SIZE))->data + offset, src, chunk);
+        src += chunk;
+        pos += chunk;
+    }
+
+    mark_dirty(bus, address, end);
+}
+
+void bus_copy_out(const bus_t *bus, uint16_t address, uint8_t *dst, size_t size) {
+    size_t end = (size_t) address + size;
+    if (end > BUS_CHUNK_COUNT * BUS_CHUNK_SIZE) end = BUS_CHUNK_COUNT * BUS_CHUNK_SIZE;
+
+    for (size_t pos = address; pos < end;) {
+        size_t offset = pos % BUS_CHUNK_SIZE;
+        size_t chunk = BUS_CHUNK_SIZE - offset < end - pos ? BUS_CHUNK_SIZE - offset : end - pos;
+
+        memcpy(dst, bus->chunks[pos / BUS_CHUNK_SIZE]->data + offset, chunk);
+        dst += chunk;
+        pos += chunk;
+    }
+}
+
+void bus_fingerprint(bus_t *bus, uint64_t root[2]) {
+    for (int page = 0; page < BUS_PAGE_COUNT; page++) {
+        if (!bus->dirty[page]) continue;
+
+        uint64_t hash = hash_page(bus->read[page]);
+        if (hash != bus->page_hash[page]) {
+            root_update(bus, page, bus->page_hash[page], 0);
+            root_update(bus, page, hash, 1);
+            bus->page_hash[page] = hash;
+        }
+
+        // The next write to this page has to go through bus_write_slow() again to mark it.
+        bus->dirty[page] = 0;
+        bus->write[page] = NULL;
+    }
+
+    root[0] = bus->root[0];
+    root[1] = bus->root[1];
+}
@@ -0,0 +1,101 @@
+#ifndef CGAMEBOY_BUS_H
+#define CGAMEBOY_BUS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define BUS_PAGE_SIZE 256
+#define BUS_PAGE_COUNT 256
+#define BUS_ROM_PAGES 0x80
+
+#define BUS_CHUNK_PAGES 16
+#define BUS_CHUNK_SIZE (BUS_CHUNK_PAGES * BUS_PAGE_SIZE)
+#define BUS_CHUNK_COUNT (BUS_PAGE_COUNT / BUS_CHUNK_PAGES)
+
+// Memory is owned in reference counted 4 KiB chunks so instances can share it. A chunk is only written in place while
+// it has a single owner. Counting chunks instead of pages keeps the atomics per clone down to 16.
+typedef struct {
+    atomic_uint refs;
+    uint8_t data[BUS_CHUNK_SIZE];
+} bus_chunk_t;
+
+// Per page breakpoint and watchpoint bitmaps, bit n of a mask standing for offset n. Only pages holding at least one
+// point have any, and only those with a watchpoint leave the write fast path.
+typedef struct {
+    uint8_t exec[BUS_PAGE_SIZE / 8];
+    uint8_t write[BUS_PAGE_SIZE / 8];
+    int writes;
+} bus_trap_t;
+
+// 64 KiB address space split into 256 byte pages. Reads always go straight through the read table. The write table
+// only points at pages that can be written in place, everything else (ROM, shared chunks, clean pages) takes
+// bus_write_slow().
+//
+// Every page caches its hash for bus_fingerprint(). Pages only get a write pointer once they are marked dirty, so the
+// fast path never has to track writes itself.
+typedef struct {
+    uint8_t *read[BUS_PAGE_COUNT];
+    uint8_t *write[BUS_PAGE_COUNT];
+    bus_chunk_t *chunks[BUS_CHUNK_COUNT];
+
+    uint8_t dirty[BUS_PAGE_COUNT];
+    uint64_t page_hash[BUS_PAGE_COUNT];
+    uint64_t root[2];
+
+    // Set by the slow write path when a watched address is written, until the debugger collects it.
+    const bus_trap_t *trap[BUS_PAGE_COUNT];
+    int trap_hit;
+    uint16_t trap_address;
+
+    int rom_writable;
+    uint8_t sink;
+} bus_t;
+
+void bus_init(bus_t *bus);
+void bus_free(bus_t *bus);
+
+// Shares all memory of src with dst. Both sides copy a chunk on their first write to it.
+void bus_clone(bus_t *dst, bus_t *src);
+
+// Installs or removes (trap = NULL) the trap of one page. Clones made afterwards share it.
+void bus_set_trap(bus_t *bus, int page, const bus_trap_t *trap);
+
+// Turns the ROM area into plain RAM, for CPU tests that put code and data anywhere in the address space.
+void bus_set_rom_writable(bus_t *bus, int writable);
+
+void bus_write_slow(bus_t *bus, uint16_t address, uint8_t value);
+uint8_t *bus_write_ptr(bus_t *bus, uint16_t address);
+
+// Bulk access for loaders and save states. Unlike bus_write(), these also write to ROM.
+void bus_clear(bus_t *bus);
+void bus_copy_in(bus_t *bus, uint16_t address, const uint8_t *src, size_t size);
+void bus_copy_out(const bus_t *bus, uint16_t address, uint8_t *dst, size_t size);
+
+// 128 bit hash of all memory. Only pages written since the last call are hashed again.
+void bus_fingerprint(bus_t *bus, uint64_t root[2]);
+
+static inline uint8_t bus_read(const bus_t *bus, uint16_t address) {
+    return bus->read[address >> 8][address & 0xff];
+}
+
+static inline uint8_t *bus_read_ptr(const bus_t *bus, uint16_t address) {
+    return &bus->read[address >> 8][address & 0xff];
+}
+
+static inline int bus_trap_exec(const bus_t *bus, uint16_t address) {
+    const bus_trap_t *trap = bus->trap[address >> 8];
+    return trap != NULL && trap->exec[(address & 0xff) >> 3] >> (address & 7) & 1;
+}
+
+static inline void bus_write(bus_t *bus, uint16_t address, uint8_t value) {
+    uint8_t *page = bus->write[address >> 8];
+
+    if (page != NULL) {
+        page[address & 0xff] = value;
+    } else {
+        bus_write_slow(bus, address, value);
+    }
+}
+
+#endif //CGAMEBOY_BUS_H
@@ -4,7 +4,7 @@
 
 #include "cpu.h"
 
-static uint8_t *decode_src_or_dst_middle(cpu_t *cpu, uint8_t *mem, uint8_t id) {
+static uint8_t *decode_src_or_dst_middle(cpu_t *cpu, bus_t *bus, uint8_t id, int write) {
     switch (id) {
         case 0: return &cpu->registers.w.B;
         case 1: return &cpu->registers.w.C;
@@ -12,66 +12,64 @@ static uint8_t *decode_src_or_dst_middle(cpu_t *cpu, uint8_t *mem, uint8_t id) {
         case 3: return &cpu->registers.w.E;
         case 4: return &cpu->registers.w.H;
         case 5: return &cpu->registers.w.L;
-        case 6: return &mem[cpu->registers.dw.HL];
+        case 6: return write
+                       ? bus_write_ptr(bus, cpu->registers.dw.HL)
+                       : bus_read_ptr(bus, cpu->registers.dw.HL);
         case 7: return &cpu->registers.w.A;
 
         default: return NULL; // Should never occur.
     }
 }
 
-static uint8_t *decode_src_middle(cpu_t *cpu, uint8_t *mem, uint8_t op) {
-    return decode_src_or_dst_middle(cpu, mem, op & 0b0111);
+static uint8_t *decode_src_middle(cpu_t *cpu, bus_t *bus, uint8_t op) {
+    return decode_src_or_dst_middle(cpu, bus, op & 0b0111, 0);
 }
 
-static uint8_t *decode_dst_middle(cpu_t *cpu, uint8_t *mem, uint8_t op) {
-    return decode_src_or_dst_middle(cpu, mem, op >> 3 & 0b0111);
+static uint8_t *decode_dst_middle(cpu_t *cpu, bus_t *bus, uint8_t op) {
+    return decode_src_or_dst_middle(cpu, bus, op >> 3 & 0b0111, 1);
 }
 
-static uint8_t *decode_dst_acb(cpu_t *cpu, uint8_t *mem, uint8_t op) {
-    uint8_t id = op >> 3 & 0b111;
-    id = id & 0b100 + (id >> 1 & 0b001) + (id << 1 & 0b010);
-
-    return decode_src_or_dst_middle(cpu, mem, id);
+static uint8_t *decode_dst_acb(cpu_t *cpu, bus_t *bus, uint8_t op) {
+    return decode_src_or_dst_middle(cpu, bus, cpu_decode_acb(op), 1);
 }
 
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wint-to-pointer-cast"
+static uint8_t *decode_src_dst_hl(cpu_t *cpu, bus_t *bus, uint8_t op, int write) {
+    uint16_t address;
 
-static uint8_t *decode_src_dst_hl(cpu_t *cpu, uint8_t op) {
     switch (op >> 4 & 0b11) {
-        case 0: return (uint8_t *) cpu->registers.dw.BC;
-        case 1: return (uint8_t *) cpu->registers.dw.DE;
-        case 2: return (uint8_t *) (cpu->registers.dw.HL++);
-        case 3: return (uint8_t *) (cpu->registers.dw.HL--);
+        case 0: address = cpu->registers.dw.BC; break;
+        case 1: address = cpu->registers.dw.DE; break;
+        case 2: address = cpu->registers.dw.HL++; break;
+        case 3: address = cpu->registers.dw.HL--; break;
 
         default: return NULL; // Should never occur.
     }
+
+    return write ? bus_write_ptr(bus, address) : bus_read_ptr(bus, address);
 }
 
-static uint8_t *decode_src_dst_sp(cpu_t *cpu, uint8_t op) {
+static uint16_t *decode_src_dst_sp(cpu_t *cpu, uint8_t op) {
     switch (op >> 4 & 0b11) {
-        case 0: return (uint8_t *) cpu->registers.dw.BC;
-        case 1: return (uint8_t *) cpu->registers.dw.DE;
-        case 2: return (uint8_t *) cpu->registers.dw.HL;
-        case 3: return (uint8_t *) cpu->registers.dw.SP;
+        case 0: return &cpu->registers.dw.BC;
+        case 1: return &cpu->registers.dw.DE;
+        case 2: return &cpu->registers.dw.HL;
+        case 3: return &cpu->registers.dw.SP;
 
         default: return NULL; // Should never occur.
     }
 }
 
-static uint8_t *decode_src_dst_af(cpu_t *cpu, uint8_t op) {
+static uint16_t *decode_src_dst_af(cpu_t *cpu, uint8_t op) {
     switch (op >> 4 & 0b11) {
-        case 0: return (uint8_t *) cpu->registers.dw.BC;
-        case 1: return (uint8_t *) cpu->registers.dw.DE;
-        case 2: return (uint8_t *) cpu->registers.dw.HL;
-        case 3: return (uint8_t *) cpu->registers.dw.AF;
+        case 0: return &cpu->registers.dw.BC;
+        case 1: return &cpu->registers.dw.DE;
+        case 2: return &cpu->registers.dw.HL;
+        case 3: return &cpu->registers.dw.AF;
 
         default: return NULL; // Should never occur.
     }
 }
 
-#pragma clang diagnostic pop
-
 static inline uint8_t did_carry_add_a(cpu_t *cpu, uint8_t old_a) {
     return (cpu->registers.w.A < old_a);
 }
@@ -88,30 +86,55 @@ static inline uint8_t did_half_carry_sub_a(cpu_t *cpu, uint8_t old_a) {
     return (cpu->registers.w.A <= 0x10 && old_a > 0x10);
 }
 
-static inline void call(cpu_t *cpu, uint8_t *mem, uint16_t target) {
+// Called after every taken jump, call and return, with PC already at the target. features is a compile-time constant
+// in every caller, so with no feature set this disappears entirely.
+static inline __attribute__((always_inline)) void branch(cpu_t *cpu, cpu_probes_t *probes, const unsigned features) {
+    if (features & CPU_FEATURE_COVERAGE) {
+        uint16_t location = cpu->registers.dw.PC * 0x9e37u;
+
+        probes->coverage[(location ^ probes->coverage_prev) & (CPU_COVERAGE_SIZE - 1)]++;
+        probes->coverage_prev = location >> 1;
+    }
+}
+
+// CALL and RST only, and ret() is RET and RETI only: the call hooks rely on every push having a matching pop.
+static inline __attribute__((always_inline)) void call(cpu_t *cpu, bus_t *bus, uint16_t target,
+                                                       cpu_probes_t *probes, const unsigned features) {
+    uint16_t return_address = cpu->registers.dw.PC;
+
     cpu->registers.dw.SP -= 2;
-    ((uint16_t*) mem)[cpu->registers.dw.SP] = cpu->registers.dw.PC;
+    bus_write(bus, cpu->registers.dw.SP, return_address & 0xff);
+    bus_write(bus, cpu->registers.dw.SP + 1, return_address >> 8);
     cpu->registers.dw.PC = target;
+
+    branch(cpu, probes, features);
+    if (features & CPU_FEATURE_CALLS) probes->on_call(probes->hook_ctx, target, return_address);
 }
 
-static inline void ret(cpu_t *cpu, const uint8_t *mem) {
-    cpu->registers.dw.PC = mem[cpu->registers.dw.SP];
+static inline __attribute__((always_inline)) void ret(cpu_t *cpu, const bus_t *bus,
+                                                      cpu_probes_t *probes, const unsigned features) {
+    cpu->registers.dw.PC = bus_read(bus, cpu->registers.dw.SP) | bus_read(bus, cpu->registers.dw.SP + 1) << 8;
     cpu->registers.dw.SP += 2;
+
+    branch(cpu, probes, features);
+    if (features & CPU_FEATURE_CALLS) probes->on_return(probes->hook_ctx, cpu->registers.dw.PC);
 }
 
 static uint16_t rst_destinations[] = { 0x00, 0x08, 0x10, 0x18, 0x20, 0x28, 0x30, 0x38 };
 
-void cpu_tick(cpu_t *cpu, uint8_t *mem) {
+// The interpreter proper. Every exported variant below instantiates it with a constant feature mask.
+static inline __attribute__((always_inline)) void tick(cpu_t *cpu, bus_t *bus,
+                                                       cpu_probes_t *probes, const unsigned features) {
     op_t op;
-    op.value = mem[cpu->registers.dw.PC++];
+    op.value = bus_read(bus, cpu->registers.dw.PC++);
 
     if (op.value >= 0x40 && op.value <= 0x7f) { // ld r, r'
-        *decode_dst_middle(cpu, mem, op.value) = *decode_src_middle(cpu, mem, op.value);
+        *decode_dst_middle(cpu, bus, op.value) = *decode_src_middle(cpu, bus, op.value);
         return;
     }
 
     if (op.value >= 0x80 && op.value <= 0xbf) { // Most of 8-bit arithmetic
-        uint8_t *src = decode_src_middle(cpu, mem, op.value);
+        uint8_t *src = decode_src_middle(cpu, bus, op.value);
 
         uint8_t old_a = cpu->registers.w.A;
         uint8_t would_be_a;
@@ -184,9 +207,16 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
         }
     }
 
-    if ((op.value & 0x11000000) == 0) { // inc, dec, ld imm
-        uint8_t *dst = decode_dst_acb(cpu, mem, op.value);
-        uint8_t old_dst = *dst;
+    if ((op.value & 0b11000000) == 0) { // inc, dec, ld imm
+        uint8_t *dst = NULL;
+        uint8_t old_dst = 0;
+
+        // Only these decode a destination. For the others in this block, decoding (HL) for writing would trip
+        // watchpoints and copy the page.
+        if ((op.value & 0b111) >= 0b100 && (op.value & 0b111) <= 0b110) {
+            dst = decode_dst_acb(cpu, bus, op.value);
+            old_dst = *dst;
+        }
 
         switch (op.value & 0b111) {
             case 0b100: // inc r
@@ -206,13 +236,13 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
 
                 return;
             case 0b110: // ld r, n
-                *dst = mem[cpu->registers.dw.PC++];
+                *dst = bus_read(bus, cpu->registers.dw.PC++);
 
                 return;
         }
 
-        uint8_t *src_dst = decode_src_dst_sp(cpu, op.value);
-        uint8_t old_src_dst = *src_dst;
+        uint16_t *src_dst = decode_src_dst_sp(cpu, op.value);
+        uint16_t old_src_dst = *src_dst;
 
         switch (op.value & 0b1111) {
             case 3: // inc rr
@@ -232,7 +262,7 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
 
                 return;
             case 1: // ld rr, nn
-                *src_dst = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
+                *src_dst = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
 
                 return;
         }
@@ -240,42 +270,42 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
 
     if ((op.value & 0b1111) == 0b0010) { // ld (rr), A / ld A, (rr)
         if ((op.value >> 6 & 0b11) == 0b00) { // ld (rr), A
-            uint8_t *dst = decode_src_dst_hl(cpu, op.value);
+            uint8_t *dst = decode_src_dst_hl(cpu, bus, op.value, 1);
             *dst = cpu->registers.w.A;
         }
 
         if ((op.value >> 6 & 0b11) == 0b10) { // ld A, (rr)
-            uint8_t *src = decode_src_dst_hl(cpu, op.value);
+            uint8_t *src = decode_src_dst_hl(cpu, bus, op.value, 0);
             cpu->registers.w.A = *src;
         }
     }
 
     if ((op.value >> 6 & 0b11) == 0b11) {
         if ((op.value & 0b1111) == 0b0001) { // pop rr
-            uint8_t *dst = decode_src_dst_af(cpu, op.value);
-            *dst = mem[cpu->registers.dw.SP];
+            uint16_t *dst = decode_src_dst_af(cpu, op.value);
+            *dst = bus_read(bus, cpu->registers.dw.SP) | bus_read(bus, cpu->registers.dw.SP + 1) << 8;
             cpu->registers.dw.SP += 2;
 
             return;
         }
 
         if ((op.value & 0b1111) == 0b0101) { // push rr
-            uint8_t *src = decode_src_dst_af(cpu, op.value);
+            uint16_t *src = decode_src_dst_af(cpu, op.value);
             cpu->registers.dw.SP -= 2;
-            mem[cpu->registers.dw.SP] = *src;
+            bus_write(bus, cpu->registers.dw.SP, *src & 0xff);
+            bus_write(bus, cpu->registers.dw.SP + 1, *src >> 8);
 
             return;
         }
 
         if ((op.value & 0b111) == 0b110) {
-            uint8_t id = op.value >> 3 & 0b111;
-            id = id & 0b100 + (id >> 1 & 0b001) + (id << 1 & 0b010);
+            uint8_t id = cpu_decode_acb(op.value);
 
-            uint8_t imm = mem[cpu->registers.dw.PC++];
+            uint8_t imm = bus_read(bus, cpu->registers.dw.PC++);
             uint8_t old_a = cpu->registers.w.A;
             uint8_t would_be_a;
 
-            switch (id & 0b111) {
+            switch (id) {
                 case 0: // add A, n
                     cpu->registers.w.A += imm;
 
@@ -344,10 +374,9 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
         }
 
         if ((op.value & 0b111) == 0b111) {
-            uint8_t id = op.value >> 3 & 0b111;
-            id = id & 0b100 + (id >> 1 & 0b001) + (id << 1 & 0b010);
+            uint8_t id = cpu_decode_acb(op.value);
 
-            call(cpu, mem, rst_destinations[id]);
+            call(cpu, bus, rst_destinations[id], probes, features);
 
             return;
         }
@@ -367,66 +396,69 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
 
             return;
         case 0x20: // JR NZ, n;
-            imm_s = (int8_t) mem[cpu->registers.dw.PC++];
+            imm_s = (int8_t) bus_read(bus, cpu->registers.dw.PC++);
 
             if (!cpu->registers.w.F.n) {
-                call(cpu, mem, imm_s);
+                cpu->registers.dw.PC += imm_s;
+                branch(cpu, probes, features);
             }
 
             return;
         case 0x30: // JR NC, n
-            imm_s = (int8_t) mem[cpu->registers.dw.PC++];
+            imm_s = (int8_t) bus_read(bus, cpu->registers.dw.PC++);
 
             if (!cpu->registers.w.F.c) {
-                imm_s = (int8_t) mem[cpu->registers.dw.PC];
-                call(cpu, mem, imm_s);
+                cpu->registers.dw.PC += imm_s;
+                branch(cpu, probes, features);
             }
 
             return;
         case 0xc0: // RET NZ
             if (!cpu->registers.w.F.n) {
-                ret(cpu, mem);
+                ret(cpu, bus, probes, features);
             }
 
             return;
         case 0xd0: // RET NC
             if (!cpu->registers.w.F.c) {
-                ret(cpu, mem);
+                ret(cpu, bus, probes, features);
             }
 
             return;
         case 0xe0: // LD (0xff00 + n), A
-            imm_u = mem[cpu->registers.dw.PC++];
-            mem[0xff00 + imm_u] = cpu->registers.w.A;
+            imm_u = bus_read(bus, cpu->registers.dw.PC++);
+            bus_write(bus, 0xff00 + imm_u, cpu->registers.w.A);
 
             return;
         case 0xf0: // LD A, (0xff00 + n)
-            imm_u = mem[cpu->registers.dw.PC++];
-            cpu->registers.w.A = mem[0xff00 + imm_u];
+            imm_u = bus_read(bus, cpu->registers.dw.PC++);
+            cpu->registers.w.A = bus_read(bus, 0xff00 + imm_u);
 
             return;
         case 0xc2: // JP NZ, nn
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
 
             if (!cpu->registers.w.F.z) {
                 cpu->registers.dw.PC = imm16_u;
+                branch(cpu, probes, features);
             }
 
             return;
         case 0xd2: // JP NC, nn
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
 
             if (!cpu->registers.w.F.c) {
                 cpu->registers.dw.PC = imm16_u;
+                branch(cpu, probes, features);
             }
 
             return;
         case 0xe2: // LD (0xff00 + C), A
-            mem[0xff00 + cpu->registers.w.C] = cpu->registers.w.A;
+            bus_write(bus, 0xff00 + cpu->registers.w.C, cpu->registers.w.A);
 
             return;
         case 0xf2: // LD A, (0xff00 + C)
-            cpu->registers.w.A = mem[0xff00 + cpu->registers.w.C];
+            cpu->registers.w.A = bus_read(bus, 0xff00 + cpu->registers.w.C);
 
             return;
         case 0xf3: // DI
@@ -434,18 +466,18 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
 
             return;
         case 0xc4: // CALL NZ, nn
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
 
             if (!cpu->registers.w.F.z) {
-                call(cpu, mem, imm16_u);
+                call(cpu, bus, imm16_u, probes, features);
             }
 
             return;
         case 0xc5: // CALL NC, nn
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
 
             if (!cpu->registers.w.F.c) {
-                call(cpu, mem, imm16_u);
+                call(cpu, bus, imm16_u, probes, features);
             }
 
             return;
@@ -497,45 +529,48 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
 
             return;
         case 0x08: // LD (nn), SP
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
-            mem[imm16_u] = cpu->registers.dw.SP;
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
+            bus_write(bus, imm16_u, cpu->registers.dw.SP);
 
             return;
         case 0x18: // JR n
-            imm_s = (int8_t) mem[cpu->registers.dw.PC]; // We jump somewhere else anyways
+            imm_s = (int8_t) bus_read(bus, cpu->registers.dw.PC); // We jump somewhere else anyways
             cpu->registers.dw.PC += imm_s;
+            branch(cpu, probes, features);
 
             return;
         case 0x28: // JR Z, n
-            imm_s = (int8_t) mem[cpu->registers.dw.PC++];
+            imm_s = (int8_t) bus_read(bus, cpu->registers.dw.PC++);
 
             if (cpu->registers.w.F.z) {
                 cpu->registers.dw.PC += imm_s;
+                branch(cpu, probes, features);
             }
 
             return;
         case 0x38: // JR C, n
-            imm_s = (int8_t) mem[cpu->registers.dw.PC++];
+            imm_s = (int8_t) bus_read(bus, cpu->registers.dw.PC++);
 
             if (cpu->registers.w.F.c) {
                 cpu->registers.dw.PC += imm_s;
+                branch(cpu, probes, features);
             }
 
             return;
         case 0xc8: // RET Z
             if (cpu->registers.w.F.z) {
-                ret(cpu, mem);
+                ret(cpu, bus, probes, features);
             }
 
             return;
         case 0xd8: // RET C
             if (cpu->registers.w.F.c) {
-                ret(cpu, mem);
+                ret(cpu, bus, probes, features);
             }
 
             return;
         case 0xe8: // ADD SP, n
-            imm_s = (int8_t) mem[cpu->registers.dw.PC++];
+            imm_s = (int8_t) bus_read(bus, cpu->registers.dw.PC++);
             tmp = cpu->registers.dw.HL;
             cpu->registers.dw.SP += imm_s;
 
@@ -549,7 +584,7 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
 
             return;
         case 0xf8: // LD HL, SP+n
-            imm_s = (int8_t) mem[cpu->registers.dw.PC++];
+            imm_s = (int8_t) bus_read(bus, cpu->registers.dw.PC++);
             tmp = cpu->registers.dw.HL;
             cpu->registers.dw.HL = cpu->registers.dw.SP + imm_s;
 
@@ -563,16 +598,17 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
 
             return;
         case 0xc9: // RET
-            ret(cpu, mem);
+            ret(cpu, bus, probes, features);
 
             return;
         case 0xd9: // RETI
-            ret(cpu, mem);
+            ret(cpu, bus, probes, features);
             cpu->state.IME = 1;
 
             return;
         case 0xe9: // JP HL
             cpu->registers.dw.PC = cpu->registers.dw.HL;
+            branch(cpu, probes, features);
 
             return;
         case 0xf9: // LD SP, HL
@@ -580,29 +616,31 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
 
             return;
         case 0xca: // JP Z, nn
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
 
             if (cpu->registers.w.F.z) {
                 cpu->registers.dw.PC = imm16_u;
+                branch(cpu, probes, features);
             }
 
             return;
         case 0xda: // JP C, nn
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
 
             if (cpu->registers.w.F.c) {
                 cpu->registers.dw.PC = imm16_u;
+                branch(cpu, probes, features);
             }
 
             return;
         case 0xea: // LD (nn), A
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
-            mem[imm16_u] = cpu->registers.w.A;
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
+            bus_write(bus, imm16_u, cpu->registers.w.A);
 
             return;
         case 0xfa: // LD A, (nn)
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
-            cpu->registers.w.A = mem[imm16_u];
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
+            cpu->registers.w.A = bus_read(bus, imm16_u);
 
             return;
         case 0xfb: // EI
@@ -610,24 +648,24 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
 
             return;
         case 0xcc: // CALL Z, nn
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
 
             if (cpu->registers.w.F.z) {
-                call(cpu, mem, imm16_u);
+                call(cpu, bus, imm16_u, probes, features);
             }
 
             return;
         case 0xdc: // CALL C, nn
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
 
             if (cpu->registers.w.F.c) {
-                call(cpu, mem, imm16_u);
+                call(cpu, bus, imm16_u, probes, features);
             }
 
             return;
         case 0xcd: // CALL nn
-            imm16_u = (mem[cpu->registers.dw.PC++] << 8) + mem[cpu->registers.dw.PC++];
-            call(cpu, mem, imm16_u);
+            imm16_u = (bus_read(bus, cpu->registers.dw.PC++) << 8) + bus_read(bus, cpu->registers.dw.PC++);
+            call(cpu, bus, imm16_u, probes, features);
 
             return;
         case 0x0f: // RRCA
@@ -665,13 +703,36 @@ void cpu_tick(cpu_t *cpu, uint8_t *mem) {
         cpu->state.stopped = 1;
     }
 
-    uint8_t cb_op = mem[cpu->registers.dw.PC++];
+    uint8_t cb_op = bus_read(bus, cpu->registers.dw.PC++);
 
     if (cb_op <= 0x3f) {
-        uint8_t *src = decode_src_or_dst_middle(cpu, mem, cb_op & 0b111);
-
+        // The operand (cb_op & 0b111) is decoded once these exist. Decoding (HL) for writing before then would trip
+        // watchpoints and copy the page for a write that never happens.
         switch (cb_op >> 3 & 0b111) {
             // TODO
         }
     }
-}
\ No newline at end of file
+}
+
+void cpu_tick(cpu_t *cpu, bus_t *bus) {
+    tick(cpu, bus, NULL, 0);
+}
+
+#define CPU_TICK_VARIANT(name, features) \
+    void name(cpu_t *cpu, bus_t *bus, cpu_probes_t *probes) { \
+        tick(cpu, bus, probes, features); \
+    }
+
+CPU_TICK_VARIANT(cpu_tick_coverage, CPU_FEATURE_COVERAGE)
+CPU_TICK_VARIANT(cpu_tick_calls, CPU_FEATURE_CALLS)
+CPU_TICK_VARIANT(cpu_tick_coverage_calls, CPU_FEATURE_COVERAGE | CPU_FEATURE_CALLS)
+
+unsigned cpu_probes_features(const cpu_probes_t *probes) {
+    if (probes == NULL) return 0;
+
+    return (probes->coverage != NULL ? CPU_FEATURE_COVERAGE : 0)
+           | (probes->on_call != NULL ? CPU_FEATURE_CALLS : 0)
+           | (probes->profile != NULL ? CPU_FEATURE_PROFILE : 0)
+           | (probes->trace != NULL ? CPU_FEATURE_TRACE : 0)
+           | (probes->debugger != NULL ? CPU_FEATURE_BREAKPOINTS : 0);
+}
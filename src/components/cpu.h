@@ -8,6 +8,8 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "bus.h"
+
 typedef struct {
     uint8_t value;
     int length;
@@ -60,6 +62,49 @@ typedef struct {
     } state;
 } cpu_t;
 
-void cpu_tick(cpu_t *cpu, uint8_t *mem);
+// Which parts of cpu_probes_t are in use. Every combination has its own compiled interpreter, see gameboy_set_probes().
+#define CPU_FEATURE_COVERAGE 0x01
+#define CPU_FEATURE_CALLS 0x02
+#define CPU_FEATURE_PROFILE 0x04
+#define CPU_FEATURE_TRACE 0x08
+#define CPU_FEATURE_BREAKPOINTS 0x10
+#define CPU_FEATURE_COUNT 32
+
+#define CPU_COVERAGE_SIZE 65536
+
+typedef struct profile profile_t;
+typedef struct trace trace_t;
+typedef struct debugger debugger_t;
+
+// Instrumentation state, every part is optional. cpu_tick() is compiled without any of it.
+typedef struct {
+    uint8_t *coverage; // AFL-style edge hit counts, CPU_COVERAGE_SIZE bytes.
+    uint16_t coverage_prev;
+
+    profile_t *profile;   // Counted by gameboy_step(), see profile.h.
+    trace_t *trace;       // Recorded by gameboy_step(), see trace.h.
+    debugger_t *debugger; // Breakpoints and watchpoints, see debugger.h.
+
+    // Run after every CALL/RST and RET/RETI with PC already at the target. return_address is what CALL pushed.
+    void (*on_call)(void *ctx, uint16_t target, uint16_t return_address);
+    void (*on_return)(void *ctx, uint16_t target);
+    void *hook_ctx;
+} cpu_probes_t;
+
+// Bits 3-5 of inc r, dec r and ld r, n pick the register in B, C, D, E, H, L, (HL), A order. The same field selects
+// the operation of the immediate ALU ops and the RST vector.
+static inline uint8_t cpu_decode_acb(uint8_t op) {
+    return op >> 3 & 0b111;
+}
+
+extern const op_t cpu_ops[256];
+extern const op_t cpu_cb_ops[256];
+
+void cpu_tick(cpu_t *cpu, bus_t *bus);
+void cpu_tick_coverage(cpu_t *cpu, bus_t *bus, cpu_probes_t *probes);
+void cpu_tick_calls(cpu_t *cpu, bus_t *bus, cpu_probes_t *probes);
+void cpu_tick_coverage_calls(cpu_t *cpu, bus_t *bus, cpu_probes_t *probes);
+
+unsigned cpu_probes_features(const cpu_probes_t *probes);
 
 #endif //CGAMEBOY_CPU_H
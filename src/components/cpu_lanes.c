@@ -0,0 +1,45 @@
+#include "cpu_lanes.h"
+
+void cpu_lanes_load(cpu_lanes_t *lanes, int lane, const cpu_t *cpu) {
+    lanes->A[lane] = cpu->registers.w.A;
+    lanes->B[lane] = cpu->registers.w.B;
+    lanes->C[lane] = cpu->registers.w.C;
+    lanes->D[lane] = cpu->registers.w.D;
+    lanes->E[lane] = cpu->registers.w.E;
+    lanes->H[lane] = cpu->registers.w.H;
+    lanes->L[lane] = cpu->registers.w.L;
+
+    lanes->z[lane] = cpu->registers.w.F.z;
+    lanes->n[lane] = cpu->registers.w.F.n;
+    lanes->h[lane] = cpu->registers.w.F.h;
+    lanes->c[lane] = cpu->registers.w.F.c;
+
+    lanes->SP[lane] = cpu->registers.dw.SP;
+    lanes->PC[lane] = cpu->registers.dw.PC;
+
+    lanes->IME[lane] = cpu->state.IME;
+    lanes->halted[lane] = cpu->state.halted;
+    lanes->stopped[lane] = cpu->state.stopped;
+}
+
+void cpu_lanes_store(const cpu_lanes_t *lanes, int lane, cpu_t *cpu) {
+    cpu->registers.w.A = lanes->A[lane];
+    cpu->registers.w.B = lanes->B[lane];
+    cpu->registers.w.C = lanes->C[lane];
+    cpu->registers.w.D = lanes->D[lane];
+    cpu->registers.w.E = lanes->E[lane];
+    cpu->registers.w.H = lanes->H[lane];
+    cpu->registers.w.L = lanes->L[lane];
+
+    cpu->registers.w.F.z = lanes->z[lane];
+    cpu->registers.w.F.n = lanes->n[lane];
+    cpu->registers.w.F.h = lanes->h[lane];
+    cpu->registers.w.F.c = lanes->c[lane];
+
+    cpu->registers.dw.SP = lanes->SP[lane];
+    cpu->registers.dw.PC = lanes->PC[lane];
+
+    cpu->state.IME = lanes->IME[lane];
+    cpu->state.halted = lanes->halted[lane];
+    cpu->state.stopped = lanes->stopped[lane];
+}
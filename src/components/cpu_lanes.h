@@ -0,0 +1,37 @@
+#ifndef CGAMEBOY_CPU_LANES_H
+#define CGAMEBOY_CPU_LANES_H
+
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define CPU_LANES_MAX 32
+
+// Structure-of-arrays cpu_t: register X of lane i lives in X[i], so the same operation on every lane is one
+// vector operation. Flags are kept as separate 0/1 bytes, the unused F bits stay in the scalar cpu_t.
+typedef struct {
+    uint8_t A[CPU_LANES_MAX];
+    uint8_t B[CPU_LANES_MAX];
+    uint8_t C[CPU_LANES_MAX];
+    uint8_t D[CPU_LANES_MAX];
+    uint8_t E[CPU_LANES_MAX];
+    uint8_t H[CPU_LANES_MAX];
+    uint8_t L[CPU_LANES_MAX];
+
+    uint8_t z[CPU_LANES_MAX];
+    uint8_t n[CPU_LANES_MAX];
+    uint8_t h[CPU_LANES_MAX];
+    uint8_t c[CPU_LANES_MAX];
+
+    uint16_t SP[CPU_LANES_MAX];
+    uint16_t PC[CPU_LANES_MAX];
+
+    uint8_t IME[CPU_LANES_MAX];
+    uint8_t halted[CPU_LANES_MAX];
+    uint8_t stopped[CPU_LANES_MAX];
+} cpu_lanes_t;
+
+void cpu_lanes_load(cpu_lanes_t *lanes, int lane, const cpu_t *cpu);
+void cpu_lanes_store(const cpu_lanes_t *lanes, int lane, cpu_t *cpu);
+
+#endif //CGAMEBOY_CPU_LANES_H
@@ -0,0 +1,217 @@
+#include "cpu.h"
+
+// Timings are in T-cycles. Conditional jumps, calls and returns list the not-taken timing.
+
+#define OPS_R8(base, prefix, len, t, t_hl) \
+    { (base) + 0, len, t, prefix "B" }, \
+    { (base) + 1, len, t, prefix "C" }, \
+    { (base) + 2, len, t, prefix "D" }, \
+    { (base) + 3, len, t, prefix "E" }, \
+    { (base) + 4, len, t, prefix "H" }, \
+    { (base) + 5, len, t, prefix "L" }, \
+    { (base) + 6, len, t_hl, prefix "(HL)" }, \
+    { (base) + 7, len, t, prefix "A" }
+
+const op_t cpu_ops[256] = {
+    { 0x00, 1, 4, "NOP" },
+    { 0x01, 3, 12, "LD BC,d16" },
+    { 0x02, 1, 8, "LD (BC),A" },
+    { 0x03, 1, 8, "INC BC" },
+    { 0x04, 1, 4, "INC B" },
+    { 0x05, 1, 4, "DEC B" },
+    { 0x06, 2, 8, "LD B,d8" },
+    { 0x07, 1, 4, "RLCA" },
+    { 0x08, 3, 20, "LD (a16),SP" },
+    { 0x09, 1, 8, "ADD HL,BC" },
+    { 0x0a, 1, 8, "LD A,(BC)" },
+    { 0x0b, 1, 8, "DEC BC" },
+    { 0x0c, 1, 4, "INC C" },
+    { 0x0d, 1, 4, "DEC C" },
+    { 0x0e, 2, 8, "LD C,d8" },
+    { 0x0f, 1, 4, "RRCA" },
+
+    { 0x10, 2, 4, "STOP" },
+    { 0x11, 3, 12, "LD DE,d16" },
+    { 0x12, 1, 8, "LD (DE),A" },
+    { 0x13, 1, 8, "INC DE" },
+    { 0x14, 1, 4, "INC D" },
+    { 0x15, 1, 4, "DEC D" },
+    { 0x16, 2, 8, "LD D,d8" },
+    { 0x17, 1, 4, "RLA" },
+    { 0x18, 2, 12, "JR r8" },
+    { 0x19, 1, 8, "ADD HL,DE" },
+    { 0x1a, 1, 8, "LD A,(DE)" },
+    { 0x1b, 1, 8, "DEC DE" },
+    { 0x1c, 1, 4, "INC E" },
+    { 0x1d, 1, 4, "DEC E" },
+    { 0x1e, 2, 8, "LD E,d8" },
+    { 0x1f, 1, 4, "RRA" },
+
+    { 0x20, 2, 8, "JR NZ,r8" },
+    { 0x21, 3, 12, "LD HL,d16" },
+    { 0x22, 1, 8, "LD (HL+),A" },
+    { 0x23, 1, 8, "INC HL" },
+    { 0x24, 1, 4, "INC H" },
+    { 0x25, 1, 4, "DEC H" },
+    { 0x26, 2, 8, "LD H,d8" },
+    { 0x27, 1, 4, "DAA" },
+    { 0x28, 2, 8, "JR Z,r8" },
+    { 0x29, 1, 8, "ADD HL,HL" },
+    { 0x2a, 1, 8, "LD A,(HL+)" },
+    { 0x2b, 1, 8, "DEC HL" },
+    { 0x2c, 1, 4, "INC L" },
+    { 0x2d, 1, 4, "DEC L" },
+    { 0x2e, 2, 8, "LD L,d8" },
+    { 0x2f, 1, 4, "CPL" },
+
+    { 0x30, 2, 8, "JR NC,r8" },
+    { 0x31, 3, 12, "LD SP,d16" },
+    { 0x32, 1, 8, "LD (HL-),A" },
+    { 0x33, 1, 8, "INC SP" },
+    { 0x34, 1, 12, "INC (HL)" },
+    { 0x35, 1, 12, "DEC (HL)" },
+    { 0x36, 2, 12, "LD (HL),d8" },
+    { 0x37, 1, 4, "SCF" },
+    { 0x38, 2, 8, "JR C,r8" },
+    { 0x39, 1, 8, "ADD HL,SP" },
+    { 0x3a, 1, 8, "LD A,(HL-)" },
+    { 0x3b, 1, 8, "DEC SP" },
+    { 0x3c, 1, 4, "INC A" },
+    { 0x3d, 1, 4, "DEC A" },
+    { 0x3e, 2, 8, "LD A,d8" },
+    { 0x3f, 1, 4, "CCF" },
+
+    OPS_R8(0x40, "LD B,", 1, 4, 8),
+    OPS_R8(0x48, "LD C,", 1, 4, 8),
+    OPS_R8(0x50, "LD D,", 1, 4, 8),
+    OPS_R8(0x58, "LD E,", 1, 4, 8),
+    OPS_R8(0x60, "LD H,", 1, 4, 8),
+    OPS_R8(0x68, "LD L,", 1, 4, 8),
+
+    { 0x70, 1, 8, "LD (HL),B" },
+    { 0x71, 1, 8, "LD (HL),C" },
+    { 0x72, 1, 8, "LD (HL),D" },
+    { 0x73, 1, 8, "LD (HL),E" },
+    { 0x74, 1, 8, "LD (HL),H" },
+    { 0x75, 1, 8, "LD (HL),L" },
+    { 0x76, 1, 4, "HALT" },
+    { 0x77, 1, 8, "LD (HL),A" },
+
+    OPS_R8(0x78, "LD A,", 1, 4, 8),
+
+    OPS_R8(0x80, "ADD A,", 1, 4, 8),
+    OPS_R8(0x88, "ADC A,", 1, 4, 8),
+    OPS_R8(0x90, "SUB ", 1, 4, 8),
+    OPS_R8(0x98, "SBC A,", 1, 4, 8),
+    OPS_R8(0xa0, "AND ", 1, 4, 8),
+    OPS_R8(0xa8, "XOR ", 1, 4, 8),
+    OPS_R8(0xb0, "OR ", 1, 4, 8),
+    OPS_R8(0xb8, "CP ", 1, 4, 8),
+
+    { 0xc0, 1, 8, "RET NZ" },
+    { 0xc1, 1, 12, "POP BC" },
+    { 0xc2, 3, 12, "JP NZ,a16" },
+    { 0xc3, 3, 16, "JP a16" },
+    { 0xc4, 3, 12, "CALL NZ,a16" },
+    { 0xc5, 1, 16, "PUSH BC" },
+    { 0xc6, 2, 8, "ADD A,d8" },
+    { 0xc7, 1, 16, "RST 00H" },
+    { 0xc8, 1, 8, "RET Z" },
+    { 0xc9, 1, 16, "RET" },
+    { 0xca, 3, 12, "JP Z,a16" },
+    { 0xcb, 1, 4, "PREFIX CB" },
+    { 0xcc, 3, 12, "CALL Z,a16" },
+    { 0xcd, 3, 24, "CALL a16" },
+    { 0xce, 2, 8, "ADC A,d8" },
+    { 0xcf, 1, 16, "RST 08H" },
+
+    { 0xd0, 1, 8, "RET NC" },
+    { 0xd1, 1, 12, "POP DE" },
+    { 0xd2, 3, 12, "JP NC,a16" },
+    { 0xd3, 1, 4, NULL },
+    { 0xd4, 3, 12, "CALL NC,a16" },
+    { 0xd5, 1, 16, "PUSH DE" },
+    { 0xd6, 2, 8, "SUB d8" },
+    { 0xd7, 1, 16, "RST 10H" },
+    { 0xd8, 1, 8, "RET C" },
+    { 0xd9, 1, 16, "RETI" },
+    { 0xda, 3, 12, "JP C,a16" },
+    { 0xdb, 1, 4, NULL },
+    { 0xdc, 3, 12, "CALL C,a16" },
+    { 0xdd, 1, 4, NULL },
+    { 0xde, 2, 8, "SBC A,d8" },
+    { 0xdf, 1, 16, "RST 18H" },
+
+    { 0xe0, 2, 12, "LDH (a8),A" },
+    { 0xe1, 1, 12, "POP HL" },
+    { 0xe2, 1, 8, "LD (C),A" },
+    { 0xe3, 1, 4, NULL },
+    { 0xe4, 1, 4, NULL },
+    { 0xe5, 1, 16, "PUSH HL" },
+    { 0xe6, 2, 8, "AND d8" },
+    { 0xe7, 1, 16, "RST 20H" },
+    { 0xe8, 2, 16, "ADD SP,r8" },
+    { 0xe9, 1, 4, "JP (HL)" },
+    { 0xea, 3, 16, "LD (a16),A" },
+    { 0xeb, 1, 4, NULL },
+    { 0xec, 1, 4, NULL },
+    { 0xed, 1, 4, NULL },
+    { 0xee, 2, 8, "XOR d8" },
+    { 0xef, 1, 16, "RST 28H" },
+
+    { 0xf0, 2, 12, "LDH A,(a8)" },
+    { 0xf1, 1, 12, "POP AF" },
+    { 0xf2, 1, 8, "LD A,(C)" },
+    { 0xf3, 1, 4, "DI" },
+    { 0xf4, 1, 4, NULL },
+    { 0xf5, 1, 16, "PUSH AF" },
+    { 0xf6, 2, 8, "OR d8" },
+    { 0xf7, 1, 16, "RST 30H" },
+    { 0xf8, 2, 12, "LD HL,SP+r8" },
+    { 0xf9, 1, 8, "LD SP,HL" },
+    { 0xfa, 3, 16, "LD A,(a16)" },
+    { 0xfb, 1, 4, "EI" },
+    { 0xfc, 1, 4, NULL },
+    { 0xfd, 1, 4, NULL },
+    { 0xfe, 2, 8, "CP d8" },
+    { 0xff, 1, 16, "RST 38H" },
+};
+
+// Timings include the fetch of the 0xcb prefix.
+const op_t cpu_cb_ops[256] = {
+    OPS_R8(0x00, "RLC ", 2, 8, 16),
+    OPS_R8(0x08, "RRC ", 2, 8, 16),
+    OPS_R8(0x10, "RL ", 2, 8, 16),
+    OPS_R8(0x18, "RR ", 2, 8, 16),
+    OPS_R8(0x20, "SLA ", 2, 8, 16),
+    OPS_R8(0x28, "SRA ", 2, 8, 16),
+    OPS_R8(0x30, "SWAP ", 2, 8, 16),
+    OPS_R8(0x38, "SRL ", 2, 8, 16),
+
+    OPS_R8(0x40, "BIT 0,", 2, 8, 12),
+    OPS_R8(0x48, "BIT 1,", 2, 8, 12),
+    OPS_R8(0x50, "BIT 2,", 2, 8, 12),
+    OPS_R8(0x58, "BIT 3,", 2, 8, 12),
+    OPS_R8(0x60, "BIT 4,", 2, 8, 12),
+    OPS_R8(0x68, "BIT 5,", 2, 8, 12),
+    OPS_R8(0x70, "BIT 6,", 2, 8, 12),
+    OPS_R8(0x78, "BIT 7,", 2, 8, 12),
+
+    OPS_R8(0x80, "RES 0,", 2, 8, 16),
+    OPS_R8(0x88, "RES 1,", 2, 8, 16),
+    OPS_R8(0x90, "RES 2,", 2, 8, 16),
+    OPS_R8(0x98, "RES 3,", 2, 8, 16),
+    OPS_R8(0xa0, "RES 4,", 2, 8, 16),
+    OPS_R8(0xa8, "RES 5,", 2, 8, 16),
+    OPS_R8(0xb0, "RES 6,", 2, 8, 16),
+    OPS_R8(0xb8, "RES 7,", 2, 8, 16),
+
+    OPS_R8(0xc0, "SET 0,", 2, 8, 16),
+    OPS_R8(0xc8, "SET 1,", 2, 8, 16),
+    OPS_R8(0xd0, "SET 2,", 2, 8, 16),
+    OPS_R8(0xd8, "SET 3,", 2, 8, 16),
+    OPS_R8(0xe0, "SET 4,", 2, 8, 16),
+    OPS_R8(0xe8, "SET 5,", 2, 8, 16),
+    OPS_R8(0xf0, "SET 6,", 2, 8, 16),
+    OPS_R8(0xf8, "SET 7,", 2, 8, 16),
+};
@@ -0,0 +1,238 @@
+#include <string.h>
+
+#include "ppu.h"
+#include "timeline.h"
+
+#define PPU_IF   0xff0f
+#define PPU_LCDC 0xff40
+#define PPU_STAT 0xff41
+#define PPU_SCY  0xff42
+#define PPU_SCX  0xff43
+#define PPU_LY   0xff44
+#define PPU_LYC  0xff45
+#define PPU_BGP  0xff47
+#define PPU_OBP0 0xff48
+#define PPU_OBP1 0xff49
+#define PPU_WY   0xff4a
+#define PPU_WX   0xff4b
+
+#define PPU_OAM 0xfe00
+#define PPU_OAM_ENTRIES 40
+#define PPU_LINE_SPRITES 10
+
+#define PPU_MODE_HBLANK 0
+#define PPU_MODE_VBLANK 1
+#define PPU_MODE_OAM 2
+#define PPU_MODE_DRAW 3
+
+#define PPU_OAM_CYCLES 80
+#define PPU_DRAW_CYCLES 172
+#define PPU_SPRITE_CYCLES 6
+
+typedef struct {
+    uint8_t y;
+    uint8_t x;
+    uint8_t tile;
+    uint8_t attributes;
+} ppu_sprite_t;
+
+// Skipping writes that change nothing keeps the I/O page shared between clones for longer.
+static void write_changed(bus_t *bus, uint16_t address, uint8_t value) {
+    if (bus_read(bus, address) != value) bus_write(bus, address, value);
+}
+
+// The STAT interrupt fires on the rising edge of the OR of all enabled sources.
+static int stat_line(uint8_t stat) {
+    uint8_t mode = stat & 3;
+
+    return (stat & 0x08 && mode == PPU_MODE_HBLANK) || (stat & 0x10 && mode == PPU_MODE_VBLANK)
+           || (stat & 0x20 && mode == PPU_MODE_OAM) || (stat & 0x44) == 0x44;
+}
+
+static void set_mode(bus_t *bus, uint8_t ly, uint8_t mode, uint8_t interrupts) {
+    uint8_t stat = bus_read(bus, PPU_STAT);
+    uint8_t updated = (stat & 0xf8) | (ly == bus_read(bus, PPU_LYC)) << 2 | mode;
+
+    if (!stat_line(stat) && stat_line(updated)) interrupts |= 0x02;
+
+    write_changed(bus, PPU_LY, ly);
+    write_changed(bus, PPU_STAT, updated);
+    if (interrupts) write_changed(bus, PPU_IF, bus_read(bus, PPU_IF) | interrupts);
+}
+
+// The first PPU_LINE_SPRITES sprites overlapping the line in OAM order, which is also what mode 3 timing depends on.
+static int scan_oam(const bus_t *bus, uint8_t line, uint8_t lcdc, ppu_sprite_t *sprites) {
+    int height = lcdc & 0x04 ? 16 : 8;
+    int count = 0;
+
+    if (!(lcdc & 0x02)) return 0;
+
+    for (int i = 0; i < PPU_OAM_ENTRIES && count < PPU_LINE_SPRITES; i++) {
+        const uint8_t *entry = bus_read_ptr(bus, PPU_OAM + i * 4);
+        int row = line + 16 - entry[0];
+
+        if (row >= 0 && row < height) {
+            ppu_sprite_t sprite = { entry[0], entry[1], entry[2], entry[3] };
+            sprites[count++] = sprite;
+        }
+    }
+
+    return count;
+}
+
+// Both bit planes of one row of a tile, low plane in the low byte.
+static uint16_t tile_row(const bus_t *bus, uint16_t address) {
+    return bus_read(bus, address) | bus_read(bus, address + 1) << 8;
+}
+
+static uint16_t bg_tile_row(const bus_t *bus, uint8_t lcdc, uint16_t map, uint8_t x, uint8_t y) {
+    uint8_t tile = bus_read(bus, map + (y >> 3) * 32 + (x >> 3));
+    uint16_t address = lcdc & 0x10 ? 0x8000 + tile * 16 : 0x9000 + (int8_t) tile * 16;
+
+    return tile_row(bus, address + (y & 7) * 2);
+}
+
+static uint8_t pixel(uint16_t row, int bit) {
+    return (row >> bit & 1) | (row >> (bit + 8) & 1) << 1;
+}
+
+static int window_visible(const bus_t *bus, uint8_t line, uint8_t lcdc) {
+    return (lcdc & 0x20) && line >= bus_read(bus, PPU_WY) && bus_read(bus, PPU_WX) < PPU_WIDTH + 7;
+}
+
+static void draw_background(const ppu_t *ppu, const bus_t *bus, uint8_t line, uint8_t lcdc, uint8_t *colors) {
+    uint8_t scx = bus_read(bus, PPU_SCX);
+    uint8_t y = line + bus_read(bus, PPU_SCY);
+    uint16_t map = lcdc & 0x08 ? 0x9c00 : 0x9800;
+    uint16_t row = 0;
+
+    for (int x = 0; x < PPU_WIDTH; x++) {
+        uint8_t bx = x + scx;
+
+        if (x == 0 || (bx & 7) == 0) row = bg_tile_row(bus, lcdc, map, bx, y);
+        colors[x] = pixel(row, 7 - (bx & 7));
+    }
+
+    if (!window_visible(bus, line, lcdc)) return;
+
+    int wx = bus_read(bus, PPU_WX) - 7;
+    map = lcdc & 0x40 ? 0x9c00 : 0x9800;
+
+    for (int x = wx < 0 ? 0 : wx; x < PPU_WIDTH; x++) {
+        uint8_t window_x = x - wx;
+
+        if (x == 0 || x == wx || (window_x & 7) == 0) row = bg_tile_row(bus, lcdc, map, window_x, ppu->window_line);
+        colors[x] = pixel(row, 7 - (window_x & 7));
+    }
+}
+
+// Sprites come in OAM order, the one with the lowest X wins, then the one first in OAM. A winning sprite hides the
+// others under it even where it is itself behind the background.
+static void draw_sprites(const bus_t *bus, uint8_t line, uint8_t lcdc, const ppu_sprite_t *sprites, int count,
+                         const uint8_t *colors, uint8_t *out) {
+    uint8_t taken[PPU_WIDTH];
+    uint8_t order[PPU_LINE_SPRITES];
+    int height = lcdc & 0x04 ? 16 : 8;
+
+    memset(taken, 0, sizeof(taken));
+
+    for (int i = 0; i < count; i++) {
+        int j = i;
+        for (; j > 0 && sprites[order[j - 1]].x > sprites[i].x; j--) order[j] = order[j - 1];
+        order[j] = (uint8_t) i;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const ppu_sprite_t *sprite = &sprites[order[i]];
+        int y = line + 16 - sprite->y;
+        uint8_t tile = height == 16 ? sprite->tile & 0xfe : sprite->tile;
+        uint8_t palette = bus_read(bus, sprite->attributes & 0x10 ? PPU_OBP1 : PPU_OBP0);
+
+        if (sprite->attributes & 0x40) y = height - 1 - y;
+
+        uint16_t row = tile_row(bus, 0x8000 + tile * 16 + y * 2);
+
+        for (int column = 0; column < 8; column++) {
+            int x = sprite->x - 8 + column;
+            if (x < 0 || x >= PPU_WIDTH || taken[x]) continue;
+
+            uint8_t color = pixel(row, sprite->attributes & 0x20 ? column : 7 - column);
+            if (color == 0) continue;
+
+            taken[x] = 1;
+            if (!(sprite->attributes & 0x80) || colors[x] == 0) out[x] = palette >> color * 2 & 3;
+        }
+    }
+}
+
+static void draw_line(ppu_t *ppu, const bus_t *bus, uint8_t line, uint8_t lcdc, const ppu_sprite_t *sprites,
+                      int count) {
+    uint64_t begin = timeline_begin();
+    uint8_t *out = ppu->framebuffer + line * PPU_WIDTH;
+    uint8_t colors[PPU_WIDTH];
+    uint8_t bgp = bus_read(bus, PPU_BGP);
+
+    if (lcdc & 0x01) {
+        draw_background(ppu, bus, line, lcdc, colors);
+        for (int x = 0; x < PPU_WIDTH; x++) out[x] = bgp >> colors[x] * 2 & 3;
+    } else { // Background and window off, white underneath the sprites.
+        memset(colors, 0, sizeof(colors));
+        memset(out, 0, PPU_WIDTH);
+    }
+
+    draw_sprites(bus, line, lcdc, sprites, count, colors, out);
+    timeline_end("ppu line", begin);
+}
+
+// Handles the mode change at ppu->next and returns the cycle of the following one.
+static uint32_t mode_change(ppu_t *ppu, bus_t *bus, int render) {
+    uint8_t line = ppu->next / PPU_LINE_CYCLES;
+    uint32_t at = ppu->next % PPU_LINE_CYCLES;
+    uint32_t line_start = ppu->next - at;
+    uint8_t lcdc = bus_read(bus, PPU_LCDC);
+
+    if (!(lcdc & 0x80)) { // LCD off: LY stays 0 in HBlank and nothing gets requested.
+        write_changed(bus, PPU_LY, 0);
+        write_changed(bus, PPU_STAT, bus_read(bus, PPU_STAT) & 0xfc);
+        return line_start + PPU_LINE_CYCLES;
+    }
+
+    if (line >= PPU_HEIGHT) {
+        set_mode(bus, line, PPU_MODE_VBLANK, line == PPU_HEIGHT ? 0x01 : 0);
+        return line_start + PPU_LINE_CYCLES;
+    }
+
+    if (at == 0) {
+        if (line == 0) ppu->window_line = 0;
+
+        set_mode(bus, line, PPU_MODE_OAM, 0);
+        return line_start + PPU_OAM_CYCLES;
+    }
+
+    if (at == PPU_OAM_CYCLES) {
+        ppu_sprite_t sprites[PPU_LINE_SPRITES];
+        int count = scan_oam(bus, line, lcdc, sprites);
+
+        if (render) draw_line(ppu, bus, line, lcdc, sprites, count);
+        if (window_visible(bus, line, lcdc)) ppu->window_line++; // Rendered or not, it's part of save states.
+
+        set_mode(bus, line, PPU_MODE_DRAW, 0);
+        return ppu->next + PPU_DRAW_CYCLES + (bus_read(bus, PPU_SCX) & 7) + count * PPU_SPRITE_CYCLES;
+    }
+
+    set_mode(bus, line, PPU_MODE_HBLANK, 0);
+    return line_start + PPU_LINE_CYCLES;
+}
+
+uint32_t ppu_run(ppu_t *ppu, bus_t *bus, uint32_t dot, int render) {
+    while (ppu->next <= dot && ppu->next < PPU_FRAME_CYCLES) {
+        ppu->next = mode_change(ppu, bus, render);
+    }
+
+    return ppu->next;
+}
+
+void ppu_end_frame(ppu_t *ppu, bus_t *bus, int render) {
+    ppu_run(ppu, bus, PPU_FRAME_CYCLES - 1, render);
+    ppu->next = 0;
+}
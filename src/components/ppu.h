@@ -0,0 +1,39 @@
+#ifndef CGAMEBOY_PPU_H
+#define CGAMEBOY_PPU_H
+
+#include <stdint.h>
+
+#include "bus.h"
+
+#define PPU_WIDTH 160
+#define PPU_HEIGHT 144
+#define PPU_LINE_CYCLES 456
+#define PPU_LINES 154
+#define PPU_FRAME_CYCLES (PPU_LINES * PPU_LINE_CYCLES)
+
+// Scanline PPU. Its registers live in the I/O page like everything else: at every mode change it updates LY and STAT
+// and requests the VBlank and STAT interrupts in IF. On frames it renders it draws the whole line when mode 3 starts.
+// Frames it skips go through exactly the same mode changes and register writes, they only leave out tile fetching and
+// the framebuffer, so skipping never changes emulation results.
+//
+// Mode 3 takes 172 + SCX % 8 + 6 cycles per sprite on the line, so OAM is scanned on every line either way.
+typedef struct {
+    uint8_t *framebuffer;     // PPU_WIDTH * PPU_HEIGHT shades 0-3 after BGP/OBP0/OBP1, owned by the caller.
+    unsigned render_interval; // Renders frames whose number is a multiple of it, 0 = never.
+
+    uint32_t next;            // Cycle within the frame of the next mode change, part of save states.
+    uint8_t window_line;      // Window row of the next line that shows it, advances on skipped frames too.
+} ppu_t;
+
+// Runs every mode change due at or before cycle dot of the frame and returns the cycle of the next one,
+// PPU_FRAME_CYCLES once the frame has none left.
+uint32_t ppu_run(ppu_t *ppu, bus_t *bus, uint32_t dot, int render);
+
+// Runs the rest of the frame's mode changes and rewinds to the start of the next one.
+void ppu_end_frame(ppu_t *ppu, bus_t *bus, int render);
+
+static inline int ppu_renders(const ppu_t *ppu, uint64_t frame) {
+    return ppu->framebuffer != NULL && ppu->render_interval != 0 && frame % ppu->render_interval == 0;
+}
+
+#endif //CGAMEBOY_PPU_H
@@ -0,0 +1,66 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "coverage.h"
+
+uint8_t *coverage_map_open(const char *name) {
+    uint8_t *map;
+
+    if (name == NULL) {
+        map = mmap(NULL, CPU_COVERAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return map == MAP_FAILED ? NULL : map;
+    }
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) return NULL;
+
+    if (ftruncate(fd, CPU_COVERAGE_SIZE) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    map = mmap(NULL, CPU_COVERAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    return map == MAP_FAILED ? NULL : map;
+}
+
+void coverage_map_close(uint8_t *map) {
+    if (map != NULL) munmap(map, CPU_COVERAGE_SIZE);
+}
+
+size_t coverage_edges(const uint8_t *map) {
+    size_t edges = 0;
+
+    for (size_t i = 0; i < CPU_COVERAGE_SIZE; i++) {
+        edges += map[i] != 0;
+    }
+
+    return edges;
+}
+
+static uint8_t bucket(uint8_t hits) {
+    if (hits == 0) return 0;
+    if (hits <= 3) return 1 << (hits - 1);
+    if (hits <= 7) return 0x08;
+    if (hits <= 15) return 0x10;
+    if (hits <= 31) return 0x20;
+    if (hits <= 127) return 0x40;
+    return 0x80;
+}
+
+size_t coverage_merge(uint8_t *seen, const uint8_t *map) {
+    size_t fresh = 0;
+
+    for (size_t i = 0; i < CPU_COVERAGE_SIZE; i++) {
+        uint8_t bits = bucket(map[i]);
+
+        if (bits & ~seen[i]) {
+            seen[i] |= bits;
+            fresh++;
+        }
+    }
+
+    return fresh;
+}
@@ -0,0 +1,20 @@
+#ifndef CGAMEBOY_COVERAGE_H
+#define CGAMEBOY_COVERAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "components/cpu.h"
+
+// Maps a CPU_COVERAGE_SIZE byte edge map. With a name it lives in POSIX shared memory, created if needed, so a fuzzer
+// in another process can read it after every run. Without one it's private to this process.
+uint8_t *coverage_map_open(const char *name);
+void coverage_map_close(uint8_t *map);
+
+size_t coverage_edges(const uint8_t *map);
+
+// AFL-style novelty check. Hit counts are bucketed (1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+), every bucket that isn't
+// in seen yet gets added to it. Returns the number of new buckets, so > 0 means the input is worth keeping.
+size_t coverage_merge(uint8_t *seen, const uint8_t *map);
+
+#endif //CGAMEBOY_COVERAGE_H
@@ -0,0 +1,85 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "debugger.h"
+
+debugger_t *debugger_attach(gameboy_t *gb) {
+    debugger_t *debugger = calloc(1, sizeof(debugger_t));
+
+    debugger->gb = gb;
+    debugger->stop = DEBUGGER_RUNNING;
+    debugger->probes.debugger = debugger;
+    gameboy_set_probes(gb, &debugger->probes);
+
+    return debugger;
+}
+
+// Clones made while attached share the traps, so they have to go first.
+void debugger_detach(debugger_t *debugger) {
+    if (debugger == NULL) return;
+    if (debugger->gb->probes == &debugger->probes) gameboy_set_probes(debugger->gb, NULL);
+
+    for (int page = 0; page < BUS_PAGE_COUNT; page++) {
+        if (debugger->pages[page] == NULL) continue;
+
+        bus_set_trap(&debugger->gb->bus, page, NULL);
+        free(debugger->pages[page]);
+    }
+
+    free(debugger);
+}
+
+static int trap_empty(const bus_trap_t *trap) {
+    for (size_t i = 0; i < sizeof(trap->exec); i++) {
+        if (trap->exec[i] != 0 || trap->write[i] != 0) return 0;
+    }
+
+    return 1;
+}
+
+static void set_bit(debugger_t *debugger, uint16_t address, int write, int enabled) {
+    int page = address >> 8;
+    bus_trap_t *trap = debugger->pages[page];
+
+    if (trap == NULL) {
+        if (!enabled) return;
+        trap = debugger->pages[page] = calloc(1, sizeof(bus_trap_t));
+    }
+
+    uint8_t *mask = (write ? trap->write : trap->exec) + ((address & 0xff) >> 3);
+    uint8_t bit = 1 << (address & 7);
+
+    if (!(*mask & bit) == !enabled) return;
+
+    *mask ^= bit;
+    if (write) trap->writes += enabled ? 1 : -1;
+
+    if (trap_empty(trap)) {
+        bus_set_trap(&debugger->gb->bus, page, NULL);
+        free(trap);
+        debugger->pages[page] = NULL;
+    } else {
+        bus_set_trap(&debugger->gb->bus, page, trap);
+    }
+}
+
+void debugger_set_breakpoint(debugger_t *debugger, uint16_t address, int enabled) {
+    set_bit(debugger, address, 0, enabled);
+}
+
+void debugger_set_watchpoint(debugger_t *debugger, uint16_t address, int enabled) {
+    set_bit(debugger, address, 1, enabled);
+}
+
+int debugger_hit_breakpoint(debugger_t *debugger, uint16_t pc) {
+    if (debugger->resume == (uint32_t) pc + 1) {
+        debugger->resume = 0;
+        return 0;
+    }
+
+    debugger->stop = DEBUGGER_BREAKPOINT;
+    debugger->pc = pc;
+    debugger->address = pc;
+    debugger->resume = (uint32_t) pc + 1;
+    return 1;
+}
@@ -0,0 +1,52 @@
+#ifndef CGAMEBOY_DEBUGGER_H
+#define CGAMEBOY_DEBUGGER_H
+
+#include <stdint.h>
+
+#include "gameboy.h"
+
+typedef enum {
+    DEBUGGER_RUNNING,
+    DEBUGGER_BREAKPOINT, // Stopped right before executing pc.
+    DEBUGGER_WATCHPOINT, // Stopped right after the instruction at pc wrote to address.
+} debugger_stop_t;
+
+// Execution breakpoints and write watchpoints. Only pages holding one of them are trapped in the bus page table,
+// everything else keeps its direct pointers. Attaching replaces gb->probes.
+struct debugger {
+    gameboy_t *gb;
+    cpu_probes_t probes;
+    bus_trap_t *pages[BUS_PAGE_COUNT];
+
+    debugger_stop_t stop;
+    uint16_t pc;
+    uint16_t address;
+
+    uint32_t resume; // pc + 1 of the breakpoint to step over next, 0 if none.
+};
+
+debugger_t *debugger_attach(gameboy_t *gb);
+void debugger_detach(debugger_t *debugger);
+
+void debugger_set_breakpoint(debugger_t *debugger, uint16_t address, int enabled);
+void debugger_set_watchpoint(debugger_t *debugger, uint16_t address, int enabled);
+
+// gameboy_step() and gameboy_run_frame() return early once stop is set. Running again resumes, stepping over the
+// breakpoint it stopped at.
+int debugger_hit_breakpoint(debugger_t *debugger, uint16_t pc);
+
+static inline int debugger_check_breakpoint(debugger_t *debugger, const bus_t *bus, uint16_t pc) {
+    return bus_trap_exec(bus, pc) && debugger_hit_breakpoint(debugger, pc);
+}
+
+static inline int debugger_check_watchpoint(debugger_t *debugger, bus_t *bus, uint16_t pc) {
+    if (!bus->trap_hit) return 0;
+
+    bus->trap_hit = 0;
+    debugger->stop = DEBUGGER_WATCHPOINT;
+    debugger->pc = pc;
+    debugger->address = bus->trap_address;
+    return 1;
+}
+
+#endif //CGAMEBOY_DEBUGGER_H
@@ -0,0 +1,287 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "explore.h"
+#include "pool.h"
+#include "timeline.h"
+
+// Nodes hold a clone rather than a save state, so children share unchanged memory and only rehash the pages they wrote.
+typedef struct {
+    gameboy_t *gb;
+    uint8_t *path;
+    size_t depth;
+
+    int64_t priority;
+    uint64_t sequence;
+} node_t;
+
+// Lock-free open addressing set of 128-bit fingerprints. A slot is claimed by its low half, 0 marks it empty and a 0 high
+// half means the claiming thread hasn't published it yet.
+typedef struct {
+    _Atomic uint64_t *keys;
+    _Atomic uint64_t *checks;
+    size_t mask;
+    atomic_size_t count;
+} fingerprint_set_t;
+
+typedef struct {
+    const explore_config_t *config;
+    explore_result_t *result;
+    fingerprint_set_t visited;
+
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    node_t *heap;
+    size_t heap_count;
+    size_t heap_capacity;
+    uint64_t next_sequence;
+    size_t nodes;
+    int active;
+    atomic_int done;
+} explore_t;
+
+static int set_insert(fingerprint_set_t *set, gameboy_fingerprint_t fingerprint) {
+    uint64_t key = fingerprint.lo ? fingerprint.lo : 1;
+    uint64_t check = fingerprint.hi | 1;
+
+    // Keep the table at most half full, beyond that everything counts as seen.
+    if (atomic_load_explicit(&set->count, memory_order_relaxed) > set->mask / 2) return 0;
+
+    for (size_t i = key & set->mask;; i = (i + 1) & set->mask) {
+        uint64_t expected = atomic_load_explicit(&set->keys[i], memory_order_acquire);
+
+        if (expected == 0) {
+            if (atomic_compare_exchange_strong(&set->keys[i], &expected, key)) {
+                atomic_store_explicit(&set->checks[i], check, memory_order_release);
+                atomic_fetch_add_explicit(&set->count, 1, memory_order_relaxed);
+                return 1;
+            }
+        }
+
+        if (expected == key) {
+            uint64_t found;
+            while ((found = atomic_load_explicit(&set->checks[i], memory_order_acquire)) == 0) {}
+
+            if (found == check) return 0;
+        }
+    }
+}
+
+static int node_before(const node_t *a, const node_t *b) {
+    if (a->priority != b->priority) return a->priority < b->priority;
+    return a->sequence < b->sequence;
+}
+
+// Called with the lock held.
+static void heap_push(explore_t *ex, node_t node) {
+    if (ex->heap_count == ex->heap_capacity) {
+        ex->heap_capacity = ex->heap_capacity ? ex->heap_capacity * 2 : 256;
+        ex->heap = realloc(ex->heap, ex->heap_capacity * sizeof(node_t));
+    }
+
+    node.sequence = ex->next_sequence++;
+
+    size_t i = ex->heap_count++;
+    while (i > 0 && node_before(&node, &ex->heap[(i - 1) / 2])) {
+        ex->heap[i] = ex->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+
+    ex->heap[i] = node;
+}
+
+// Called with the lock held.
+static node_t heap_pop(explore_t *ex) {
+    node_t top = ex->heap[0];
+    node_t last = ex->heap[--ex->heap_count];
+    size_t i = 0;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= ex->heap_count) break;
+
+        if (child + 1 < ex->heap_count && node_before(&ex->heap[child + 1], &ex->heap[child])) child++;
+        if (!node_before(&ex->heap[child], &last)) break;
+
+        ex->heap[i] = ex->heap[child];
+        i = child;
+    }
+
+    if (ex->heap_count > 0) ex->heap[i] = last;
+    return top;
+}
+
+static int64_t node_priority(const explore_t *ex, const gameboy_t *gb, size_t depth) {
+    if (ex->config->mode == EXPLORE_BEST_FIRST && ex->config->score != NULL) {
+        return -ex->config->score(gb, ex->config->ctx);
+    }
+
+    return (int64_t) depth;
+}
+
+static void finish(explore_t *ex, const uint8_t *path, size_t length) {
+    pthread_mutex_lock(&ex->lock);
+
+    if (!ex->done) {
+        ex->done = 1;
+        ex->result->found = 1;
+        ex->result->path = malloc(length ? length : 1);
+        memcpy(ex->result->path, path, length);
+        ex->result->path_length = length;
+    }
+
+    pthread_cond_broadcast(&ex->changed);
+    pthread_mutex_unlock(&ex->lock);
+}
+
+static void expand(explore_t *ex, const node_t *node) {
+    const explore_config_t *config = ex->config;
+    uint8_t *path = malloc(node->depth + 1);
+    uint64_t begin = timeline_begin();
+
+    if (node->depth > 0) memcpy(path, node->path, node->depth);
+
+    for (size_t i = 0; i < config->input_count && !ex->done; i++) {
+        gameboy_t *gb = gameboy_clone(node->gb);
+        gb->joypad = config->inputs[i];
+        path[node->depth] = config->inputs[i];
+
+        for (unsigned frame = 0; frame < config->frames_per_step; frame++) {
+            gameboy_run_frame(gb);
+        }
+
+        if (!set_insert(&ex->visited, gameboy_fingerprint(gb))) {
+            pthread_mutex_lock(&ex->lock);
+            ex->result->duplicates++;
+            pthread_mutex_unlock(&ex->lock);
+
+            gameboy_destroy(gb);
+            continue;
+        }
+
+        if (config->goal(gb, config->ctx)) {
+            finish(ex, path, node->depth + 1);
+            gameboy_destroy(gb);
+            break;
+        }
+
+        if (node->depth + 1 >= config->max_depth) {
+            gameboy_destroy(gb);
+            continue;
+        }
+
+        node_t child = { gb, malloc(node->depth + 1), node->depth + 1, 0, 0 };
+        memcpy(child.path, path, node->depth + 1);
+        child.priority = node_priority(ex, gb, child.depth);
+
+        pthread_mutex_lock(&ex->lock);
+        ex->result->visited++;
+
+        if (ex->nodes < config->max_nodes) {
+            ex->nodes++;
+            heap_push(ex, child);
+            pthread_cond_signal(&ex->changed);
+        } else {
+            gameboy_destroy(child.gb);
+            free(child.path);
+        }
+
+        pthread_mutex_unlock(&ex->lock);
+    }
+
+    free(path);
+    timeline_end("expand", begin);
+}
+
+static void worker(void *arg, int worker_id) {
+    (void) worker_id;
+
+    explore_t *ex = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&ex->lock);
+        while (ex->heap_count == 0 && ex->active > 0 && !ex->done) {
+            pthread_cond_wait(&ex->changed, &ex->lock);
+        }
+
+        if (ex->done || ex->heap_count == 0) {
+            pthread_cond_broadcast(&ex->changed);
+            pthread_mutex_unlock(&ex->lock);
+            break;
+        }
+
+        node_t node = heap_pop(ex);
+        ex->active++;
+        ex->result->expanded++;
+        pthread_mutex_unlock(&ex->lock);
+
+        expand(ex, &node);
+        gameboy_destroy(node.gb);
+        free(node.path);
+
+        pthread_mutex_lock(&ex->lock);
+        ex->active--;
+        if (ex->active == 0 && ex->heap_count == 0) pthread_cond_broadcast(&ex->changed);
+        pthread_mutex_unlock(&ex->lock);
+    }
+}
+
+int explore_run(gameboy_t *start, const explore_config_t *config, explore_result_t *result) {
+    memset(result, 0, sizeof(explore_result_t));
+    if (config->goal == NULL || config->input_count == 0) return -1;
+
+    if (config->goal(start, config->ctx)) {
+        result->found = 1;
+        return 0;
+    }
+
+    explore_t ex;
+    memset(&ex, 0, sizeof(ex));
+    ex.config = config;
+    ex.result = result;
+
+    size_t slots = 1024;
+    while (slots < config->max_nodes * config->input_count * 2) slots *= 2;
+
+    ex.visited.keys = calloc(slots, sizeof(uint64_t));
+    ex.visited.checks = calloc(slots, sizeof(uint64_t));
+    ex.visited.mask = slots - 1;
+    atomic_init(&ex.visited.count, 0);
+
+    pthread_mutex_init(&ex.lock, NULL);
+    pthread_cond_init(&ex.changed, NULL);
+
+    node_t root = { gameboy_clone(start), NULL, 0, 0, 0 };
+    set_insert(&ex.visited, gameboy_fingerprint(root.gb));
+    root.priority = node_priority(&ex, root.gb, 0);
+    heap_push(&ex, root);
+    ex.nodes = 1;
+
+    pool_t *pool = pool_create(config->threads);
+    for (int i = 0; i < pool_size(pool); i++) {
+        pool_submit(pool, worker, &ex);
+    }
+    pool_destroy(pool);
+
+    while (ex.heap_count > 0) {
+        node_t node = heap_pop(&ex);
+        gameboy_destroy(node.gb);
+        free(node.path);
+    }
+
+    free(ex.heap);
+    free((void *) ex.visited.keys);
+    free((void *) ex.visited.checks);
+    pthread_mutex_destroy(&ex.lock);
+    pthread_cond_destroy(&ex.changed);
+
+    return 0;
+}
+
+void explore_result_free(explore_result_t *result) {
+    free(result->path);
+    result->path = NULL;
+    result->path_length = 0;
+}
@@ -0,0 +1,47 @@
+#ifndef CGAMEBOY_EXPLORE_H
+#define CGAMEBOY_EXPLORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "gameboy.h"
+
+typedef enum {
+    EXPLORE_BREADTH_FIRST,
+    EXPLORE_BEST_FIRST,
+} explore_mode_t;
+
+// Every step holds one of the candidate joypad states for frames_per_step frames. The goal and score callbacks run on
+// the worker threads, each with its own instance, so ctx must be safe to read concurrently.
+typedef struct {
+    explore_mode_t mode;
+    int threads;
+
+    unsigned frames_per_step;
+    const uint8_t *inputs;
+    size_t input_count;
+
+    size_t max_depth;
+    size_t max_nodes; // Also sizes the fingerprint set, 32 bytes per node and input.
+
+    int (*goal)(const gameboy_t *gb, void *ctx);
+    int64_t (*score)(const gameboy_t *gb, void *ctx); // Best-first only, higher is expanded first.
+    void *ctx;
+} explore_config_t;
+
+typedef struct {
+    int found;
+    uint8_t *path; // Input held during each step leading to the goal.
+    size_t path_length;
+
+    size_t expanded;
+    size_t visited;
+    size_t duplicates;
+} explore_result_t;
+
+// Searches input sequences from the given start state, skipping every state whose fingerprint was seen before. start
+// is only cloned, but cloning drops its in-place write pointers.
+int explore_run(gameboy_t *start, const explore_config_t *config, explore_result_t *result);
+void explore_result_free(explore_result_t *result);
+
+#endif //CGAMEBOY_EXPLORE_H
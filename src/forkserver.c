@@ -0,0 +1,84 @@
+#include <inttypes.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "forkserver.h"
+#include "input.h"
+
+static void run_child(gameboy_t *gb, const char *id, uint64_t frames, const char *input_path, int fd) {
+    input_script_t script = { NULL, 0 };
+    char result[320];
+    int length;
+    int failed = input_path[0] && input_script_load(&script, input_path) != 0;
+
+    if (failed) {
+        length = snprintf(result, sizeof(result), "%s failed\n", id);
+    } else {
+        input_script_run(&script, gb, frames);
+        length = snprintf(result, sizeof(result), "%s %016" PRIx64 "\n", id, gameboy_hash(gb));
+    }
+
+    // One write per line keeps results from concurrent children intact, lines are far below PIPE_BUF.
+    if (write(fd, result, length) != length) _exit(1);
+    _exit(failed ? 1 : 0);
+}
+
+int forkserver_run(gameboy_t *gb, FILE *in, FILE *out, int max_children) {
+    if (max_children <= 0) max_children = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_children <= 0) max_children = 1;
+
+    int running = 0;
+    int failures = 0;
+    char line[1024];
+
+    fflush(out);
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        char *comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+
+        char id[256];
+        char input_path[256] = "";
+        unsigned long long frames;
+
+        int fields = sscanf(line, "%255s %llu %255s", id, &frames, input_path);
+        if (fields <= 0) continue;
+
+        if (fields < 2) {
+            fprintf(out, "%s failed\n", id);
+            fflush(out);
+            failures++;
+            continue;
+        }
+
+        if (running == max_children) {
+            int status;
+            if (wait(&status) > 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) failures++;
+            running--;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            run_child(gb, id, frames, input_path, fileno(out));
+        }
+
+        if (pid < 0) {
+            fprintf(out, "%s failed\n", id);
+            fflush(out);
+            failures++;
+            continue;
+        }
+
+        running++;
+    }
+
+    while (running > 0) {
+        int status;
+        if (wait(&status) <= 0) break;
+        if (!(WIFEXITED(status) && WEXITSTATUS(status) == 0)) failures++;
+        running--;
+    }
+
+    return failures ? -1 : 0;
+}
@@ -0,0 +1,14 @@
+#ifndef CGAMEBOY_FORKSERVER_H
+#define CGAMEBOY_FORKSERVER_H
+
+#include <stdio.h>
+
+#include "gameboy.h"
+
+// Serves jobs from an already loaded and warmed up instance. Every job line "<id> <frames> [input script]" read from
+// in forks a child that continues from the warm state, so the kernel only copies the pages the job actually touches.
+// Children print "<id> <hash>" or "<id> failed" to out as soon as they finish, so results can arrive out of order.
+// At most max_children jobs run at once, <= 0 means one per core.
+int forkserver_run(gameboy_t *gb, FILE *in, FILE *out, int max_children);
+
+#endif //CGAMEBOY_FORKSERVER_H
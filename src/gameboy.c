@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debugger.h"
+#include "gameboy.h"
+#include "profile.h"
+#include "timeline.h"
+#include "trace.h"
+
+static const struct {
+    uint16_t address;
+    uint8_t value;
+} post_boot_io[] = {
+    { 0xff00, 0xcf }, { 0xff05, 0x00 }, { 0xff06, 0x00 }, { 0xff07, 0x00 },
+    { 0xff10, 0x80 }, { 0xff11, 0xbf }, { 0xff12, 0xf3 }, { 0xff14, 0xbf },
+    { 0xff16, 0x3f }, { 0xff17, 0x00 }, { 0xff19, 0xbf }, { 0xff1a, 0x7f },
+    { 0xff1b, 0xff }, { 0xff1c, 0x9f }, { 0xff1e, 0xbf }, { 0xff20, 0xff },
+    { 0xff21, 0x00 }, { 0xff22, 0x00 }, { 0xff23, 0xbf }, { 0xff24, 0x77 },
+    { 0xff25, 0xf3 }, { 0xff26, 0xf1 }, { 0xff40, 0x91 }, { 0xff42, 0x00 },
+    { 0xff43, 0x00 }, { 0xff45, 0x00 }, { 0xff47, 0xfc }, { 0xff48, 0xff },
+    { 0xff49, 0xff }, { 0xff4a, 0x00 }, { 0xff4b, 0x00 }, { 0xffff, 0x00 },
+};
+
+gameboy_t *gameboy_create(void) {
+    gameboy_t *gb = malloc(sizeof(gameboy_t));
+    gameboy_set_probes(gb, NULL);
+    gameboy_set_render(gb, NULL, 0);
+    bus_init(&gb->bus);
+    gameboy_reset(gb, NULL, 0);
+
+    return gb;
+}
+
+void gameboy_destroy(gameboy_t *gb) {
+    if (gb == NULL) return;
+
+    bus_free(&gb->bus);
+    free(gb);
+}
+
+// Costs the instance struct and a page table. Memory pages are shared until either side writes to them.
+gameboy_t *gameboy_clone(gameboy_t *gb) {
+    gameboy_t *clone = malloc(sizeof(gameboy_t));
+
+    *clone = *gb;
+    bus_clone(&clone->bus, &gb->bus);
+    gameboy_set_render(clone, NULL, 0);
+
+    return clone;
+}
+
+// Puts the machine into the documented DMG state right after the boot ROM hands over to the cartridge.
+void gameboy_reset(gameboy_t *gb, const uint8_t *rom, size_t rom_size) {
+    memset(&gb->cpu, 0, sizeof(gb->cpu));
+    gb->joypad = 0;
+    gb->cycles = 0;
+    gb->frames = 0;
+    gb->instructions = 0;
+    gb->ppu.next = 0;
+    gb->ppu.window_line = 0;
+
+    if (rom_size > GAMEBOY_ROM_SIZE) {
+        rom_size = GAMEBOY_ROM_SIZE;
+    }
+
+    bus_clear(&gb->bus);
+    if (rom != NULL) {
+        bus_copy_in(&gb->bus, 0, rom, rom_size);
+    }
+
+    for (size_t i = 0; i < sizeof(post_boot_io) / sizeof(post_boot_io[0]); i++) {
+        bus_write(&gb->bus, post_boot_io[i].address, post_boot_io[i].value);
+    }
+
+    gb->cpu.registers.w.A = 0x01;
+    gb->cpu.registers.w.F.z = 1;
+    gb->cpu.registers.w.F.h = 1;
+    gb->cpu.registers.w.F.c = 1;
+    gb->cpu.registers.w.B = 0x00;
+    gb->cpu.registers.w.C = 0x13;
+    gb->cpu.registers.w.D = 0x00;
+    gb->cpu.registers.w.E = 0xd8;
+    gb->cpu.registers.w.H = 0x01;
+    gb->cpu.registers.w.L = 0x4d;
+    gb->cpu.registers.dw.SP = 0xfffe;
+    gb->cpu.registers.dw.PC = 0x0100;
+}
+
+void gameboy_update_joypad(gameboy_t *gb) {
+    uint8_t old = bus_read(&gb->bus, 0xff00);
+    uint8_t p1 = old | 0xcf;
+
+    if (!(p1 & 0x10)) p1 &= ~(gb->joypad >> 4 & 0x0f);
+    if (!(p1 & 0x20)) p1 &= ~(gb->joypad & 0x0f);
+
+    // Skipping redundant writes keeps the I/O page shared between clones for as long as possible.
+    if (p1 != old) bus_write(&gb->bus, 0xff00, p1);
+}
+
+// Executes one instruction and returns the number of T-cycles it took, 0 if a breakpoint stopped it. features is a
+// compile-time constant in every instantiation below, so disabled probes cost nothing.
+static inline __attribute__((always_inline)) int step(gameboy_t *gb, const unsigned features) {
+    int cycles = 4;
+
+    if (features & CPU_FEATURE_BREAKPOINTS) gb->probes->debugger->stop = DEBUGGER_RUNNING;
+
+    if (!gb->cpu.state.halted && !gb->cpu.state.stopped) {
+        uint16_t pc = gb->cpu.registers.dw.PC;
+
+        if ((features & CPU_FEATURE_BREAKPOINTS) && debugger_check_breakpoint(gb->probes->debugger, &gb->bus, pc)) {
+            return 0;
+        }
+
+        uint8_t opcode = bus_read(&gb->bus, pc);
+
+        cycles = opcode == 0xcb
+                 ? cpu_cb_ops[bus_read(&gb->bus, pc + 1)].timing
+                 : cpu_ops[opcode].timing;
+
+        gameboy_update_joypad(gb);
+        if (features & CPU_FEATURE_BREAKPOINTS) gb->bus.trap_hit = 0; // That was the hardware, not the program.
+
+        if (features & CPU_FEATURE_PROFILE) {
+            profile_record(gb->probes->profile, pc, opcode, bus_read(&gb->bus, pc + 1), cycles);
+        }
+
+        if (features & CPU_FEATURE_TRACE) {
+            trace_record(gb->probes->trace, gb, opcode, bus_read(&gb->bus, pc + 1));
+        }
+
+        switch (features & (CPU_FEATURE_COVERAGE | CPU_FEATURE_CALLS)) {
+            case CPU_FEATURE_COVERAGE: cpu_tick_coverage(&gb->cpu, &gb->bus, gb->probes); break;
+            case CPU_FEATURE_CALLS: cpu_tick_calls(&gb->cpu, &gb->bus, gb->probes); break;
+            case CPU_FEATURE_COVERAGE | CPU_FEATURE_CALLS:
+                cpu_tick_coverage_calls(&gb->cpu, &gb->bus, gb->probes);
+                break;
+
+            default: cpu_tick(&gb->cpu, &gb->bus); break;
+        }
+
+        if (features & CPU_FEATURE_BREAKPOINTS) debugger_check_watchpoint(gb->probes->debugger, &gb->bus, pc);
+        gb->instructions++;
+    } else if (features & CPU_FEATURE_PROFILE) {
+        gb->probes->profile->idle_cycles += cycles;
+    }
+
+    gb->cycles += cycles;
+    return cycles;
+}
+
+static inline __attribute__((always_inline)) void run_frame(gameboy_t *gb, const unsigned features) {
+    uint64_t frame_start = gb->frames * GAMEBOY_FRAME_CYCLES;
+    uint64_t frame_end = frame_start + GAMEBOY_FRAME_CYCLES;
+    uint64_t mode_change = frame_start + gb->ppu.next;
+    int render = ppu_renders(&gb->ppu, gb->frames);
+    // CPU time between mode changes, so the "ppu line" scopes the mode changes record are siblings instead of nested.
+    uint64_t batch = timeline_begin();
+
+    while (gb->cycles < frame_end) {
+        if (gb->cycles >= mode_change) {
+            timeline_end("cpu", batch);
+            mode_change = frame_start + ppu_run(&gb->ppu, &gb->bus, gb->cycles - frame_start, render);
+            batch = timeline_begin();
+        }
+
+        // Nothing wakes the CPU up yet, so idling goes straight to the next mode change in the same 4 cycle steps.
+        if (gb->cpu.state.halted || gb->cpu.state.stopped) {
+            uint64_t until = mode_change < frame_end ? mode_change : frame_end;
+            uint64_t cycles = (until - gb->cycles + 3) / 4 * 4;
+
+            if (features & CPU_FEATURE_BREAKPOINTS) gb->probes->debugger->stop = DEBUGGER_RUNNING;
+            if (features & CPU_FEATURE_PROFILE) gb->probes->profile->idle_cycles += cycles;
+            gb->cycles += cycles;
+            continue;
+        }
+
+        step(gb, features);
+
+        // Leaves the frame unfinished, running again picks it up from here.
+        if ((features & CPU_FEATURE_BREAKPOINTS) && gb->probes->debugger->stop != DEBUGGER_RUNNING) {
+            timeline_end("cpu", batch);
+            return;
+        }
+    }
+
+    timeline_end("cpu", batch);
+    ppu_end_frame(&gb->ppu, &gb->bus, render);
+    gb->frames++;
+}
+
+#define GAMEBOY_VARIANTS(X) \
+    X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) \
+    X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31)
+
+#define GAMEBOY_VARIANT(features) \
+    static int step_##features(gameboy_t *gb) { return step(gb, features); } \
+    static void run_frame_##features(gameboy_t *gb) { run_frame(gb, features); }
+
+#define GAMEBOY_VARIANT_ENTRY(features) [features] = { step_##features, run_frame_##features },
+
+GAMEBOY_VARIANTS(GAMEBOY_VARIANT)
+
+static const struct {
+    int (*step)(gameboy_t *gb);
+    void (*run_frame)(gameboy_t *gb);
+} variants[CPU_FEATURE_COUNT] = {
+    GAMEBOY_VARIANTS(GAMEBOY_VARIANT_ENTRY)
+};
+
+// Picks the interpreter for whatever probes has set right now. Call it again after enabling or removing a probe.
+void gameboy_set_probes(gameboy_t *gb, cpu_probes_t *probes) {
+    unsigned features = cpu_probes_features(probes);
+
+    gb->probes = probes;
+    gb->step = variants[features].step;
+    gb->run_frame = variants[features].run_frame;
+}
+
+void gameboy_set_render(gameboy_t *gb, uint8_t *framebuffer, unsigned interval) {
+    gb->ppu.framebuffer = framebuffer;
+    gb->ppu.render_interval = interval;
+}
+
+int gameboy_step(gameboy_t *gb) {
+    return gb->step(gb);
+}
+
+void gameboy_run_frame(gameboy_t *gb) {
+    uint64_t begin = timeline_begin();
+
+    gb->run_frame(gb);
+    timeline_end("frame", begin);
+}
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static inline uint64_t fnv1a(uint64_t hash, const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+// Hashes the architectural state only, so padding and host pointers never leak into the result.
+uint64_t gameboy_hash(const gameboy_t *gb) {
+    uint8_t state = gb->cpu.state.IME | gb->cpu.state.halted << 1 | gb->cpu.state.stopped << 2;
+
+    uint64_t hash = fnv1a(FNV_OFFSET, (const uint8_t *) &gb->cpu.registers, sizeof(gb->cpu.registers));
+    hash = fnv1a(hash, &state, 1);
+    for (int i = 0; i < BUS_PAGE_COUNT; i++) {
+        hash = fnv1a(hash, gb->bus.read[i], BUS_PAGE_SIZE);
+    }
+
+    return hash;
+}
+
+// Only rehashes memory pages written since the last fingerprint of this instance or the one it was cloned from.
+gameboy_fingerprint_t gameboy_fingerprint(gameboy_t *gb) {
+    uint8_t state = gb->cpu.state.IME | gb->cpu.state.halted << 1 | gb->cpu.state.stopped << 2;
+    uint64_t root[2];
+
+    bus_fingerprint(&gb->bus, root);
+
+    uint64_t registers = fnv1a(FNV_OFFSET, (const uint8_t *) &gb->cpu.registers, sizeof(gb->cpu.registers));
+    registers = fnv1a(registers, &state, 1);
+
+    gameboy_fingerprint_t fingerprint = { root[0] ^ registers, root[1] + registers * FNV_PRIME };
+    return fingerprint;
+}
+
+uint8_t *gameboy_read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t *data = length > 0 ? malloc(length) : NULL;
+    if (data == NULL || fread(data, 1, length, file) != (size_t) length) {
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    *size = length;
+    return data;
+}
@@ -0,0 +1,71 @@
+#ifndef CGAMEBOY_GAMEBOY_H
+#define CGAMEBOY_GAMEBOY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "components/bus.h"
+#include "components/cpu.h"
+#include "components/ppu.h"
+
+#define GAMEBOY_MEM_SIZE 65536
+#define GAMEBOY_ROM_SIZE 0x8000
+#define GAMEBOY_FRAME_CYCLES PPU_FRAME_CYCLES
+
+// Joypad bits, 1 = pressed.
+#define JOYPAD_A      0x01
+#define JOYPAD_B      0x02
+#define JOYPAD_SELECT 0x04
+#define JOYPAD_START  0x08
+#define JOYPAD_RIGHT  0x10
+#define JOYPAD_LEFT   0x20
+#define JOYPAD_UP     0x40
+#define JOYPAD_DOWN   0x80
+
+typedef struct gameboy gameboy_t;
+
+// Everything belonging to one emulated machine. Instances only ever share memory pages copy-on-write, so each thread
+// can own its own.
+struct gameboy {
+    cpu_t cpu;
+    bus_t bus;
+    ppu_t ppu;
+
+    uint8_t joypad;
+    uint64_t cycles;
+    uint64_t frames;
+    uint64_t instructions; // Statistics only, not part of hashes or save states.
+
+    cpu_probes_t *probes; // Set through gameboy_set_probes(). Clones share it.
+
+    // The interpreter variant compiled for exactly the features in probes.
+    int (*step)(gameboy_t *gb);
+    void (*run_frame)(gameboy_t *gb);
+};
+
+// 128 bit state identity for deduplication. Unlike gameboy_hash() it is not meant to be printed or stored.
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} gameboy_fingerprint_t;
+
+gameboy_t *gameboy_create(void);
+void gameboy_destroy(gameboy_t *gb);
+gameboy_t *gameboy_clone(gameboy_t *gb);
+
+void gameboy_reset(gameboy_t *gb, const uint8_t *rom, size_t rom_size);
+void gameboy_update_joypad(gameboy_t *gb);
+void gameboy_set_probes(gameboy_t *gb, cpu_probes_t *probes);
+
+// Renders every interval-th frame into framebuffer (PPU_WIDTH * PPU_HEIGHT shades), nothing with framebuffer NULL or
+// interval 0. Frames that aren't rendered run the same, only faster. Clones start out not rendering.
+void gameboy_set_render(gameboy_t *gb, uint8_t *framebuffer, unsigned interval);
+int gameboy_step(gameboy_t *gb);
+void gameboy_run_frame(gameboy_t *gb);
+
+uint64_t gameboy_hash(const gameboy_t *gb);
+gameboy_fingerprint_t gameboy_fingerprint(gameboy_t *gb);
+
+uint8_t *gameboy_read_file(const char *path, size_t *size);
+
+#endif //CGAMEBOY_GAMEBOY_H
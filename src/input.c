@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "input.h"
+
+static int parse_buttons(const char *text, uint8_t *buttons) {
+    *buttons = 0;
+
+    for (; *text; text++) {
+        switch (*text) {
+            case 'A': *buttons |= JOYPAD_A; break;
+            case 'B': *buttons |= JOYPAD_B; break;
+            case 's': *buttons |= JOYPAD_SELECT; break;
+            case 'S': *buttons |= JOYPAD_START; break;
+            case 'R': *buttons |= JOYPAD_RIGHT; break;
+            case 'L': *buttons |= JOYPAD_LEFT; break;
+            case 'U': *buttons |= JOYPAD_UP; break;
+            case 'D': *buttons |= JOYPAD_DOWN; break;
+            case '.': break;
+
+            default: return -1;
+        }
+    }
+
+    return 0;
+}
+
+void input_format_buttons(uint8_t buttons, char *text) {
+    static const char letters[8] = { 'A', 'B', 's', 'S', 'R', 'L', 'U', 'D' };
+    char *out = text;
+
+    for (int i = 0; i < 8; i++) {
+        if (buttons & (1 << i)) *out++ = letters[i];
+    }
+
+    if (out == text) *out++ = '.';
+    *out = '\0';
+}
+
+int input_script_load(input_script_t *script, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return -1;
+
+    size_t capacity = 0;
+    char line[256];
+
+    script->events = NULL;
+    script->count = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+
+        unsigned long long frame;
+        char buttons[16];
+        int fields = sscanf(line, "%llu %15s", &frame, buttons);
+
+        if (fields <= 0) continue;
+
+        input_event_t event = { frame, 0 };
+        if (fields != 2 || parse_buttons(buttons, &event.buttons) != 0) {
+            input_script_free(script);
+            fclose(file);
+            return -1;
+        }
+
+        if (script->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            script->events = realloc(script->events, capacity * sizeof(input_event_t));
+        }
+
+        // Scripts are almost always written in order, so keeping them sorted on insertion is cheap. Later lines win
+        // over earlier ones for the same frame.
+        size_t i = script->count++;
+        while (i > 0 && script->events[i - 1].frame > event.frame) {
+            script->events[i] = script->events[i - 1];
+            i--;
+        }
+
+        script->events[i] = event;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+void input_script_free(input_script_t *script) {
+    free(script->events);
+    script->events = NULL;
+    script->count = 0;
+}
+
+// Applies every joypad change up to the instance's current frame, starting at event index next. Returns the index of
+// the first event that still lies in the future.
+size_t input_script_apply(const input_script_t *script, size_t next, gameboy_t *gb) {
+    while (script != NULL && next < script->count && script->events[next].frame <= gb->frames) {
+        gb->joypad = script->events[next++].buttons;
+    }
+
+    return next;
+}
+
+// Runs the given number of frames, applying every joypad change right before the frame it belongs to.
+void input_script_run(const input_script_t *script, gameboy_t *gb, uint64_t frames) {
+    size_t next = 0;
+    uint64_t end = gb->frames + frames;
+
+    while (gb->frames < end) {
+        next = input_script_apply(script, next, gb);
+        gameboy_run_frame(gb);
+    }
+}
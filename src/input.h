@@ -0,0 +1,30 @@
+#ifndef CGAMEBOY_INPUT_H
+#define CGAMEBOY_INPUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "gameboy.h"
+
+typedef struct {
+    uint64_t frame;
+    uint8_t buttons;
+} input_event_t;
+
+// Joypad changes sorted by frame. Text format, one change per line: "<frame> <buttons>", where buttons is any
+// combination of A, B, s (select), S (start), R, L, U, D, or "." for nothing pressed. '#' starts a comment.
+typedef struct {
+    input_event_t *events;
+    size_t count;
+} input_script_t;
+
+int input_script_load(input_script_t *script, const char *path);
+void input_script_free(input_script_t *script);
+
+// Writes buttons in the script notation, text must hold at least 9 bytes.
+void input_format_buttons(uint8_t buttons, char *text);
+
+size_t input_script_apply(const input_script_t *script, size_t next, gameboy_t *gb);
+void input_script_run(const input_script_t *script, gameboy_t *gb, uint64_t frames);
+
+#endif //CGAMEBOY_INPUT_H
@@ -0,0 +1,314 @@
+#include <string.h>
+
+#include "lockstep.h"
+#include "simd.h"
+#include "timeline.h"
+
+// The kernels always work on all CPU_LANES_MAX lanes and blend the results through the lane mask, so they compile into
+// straight vector code.
+#define LANES_FOR(i) for (int i = 0; i < CPU_LANES_MAX; i++)
+
+static uint8_t *lane_register(cpu_lanes_t *cpu, uint8_t id) {
+    switch (id) {
+        case 0: return cpu->B;
+        case 1: return cpu->C;
+        case 2: return cpu->D;
+        case 3: return cpu->E;
+        case 4: return cpu->H;
+        case 5: return cpu->L;
+        case 7: return cpu->A;
+
+        default: return NULL; // (HL), handled by cpu_tick.
+    }
+}
+
+SIMD_KERNEL
+static void lanes_move(uint8_t *dst, const uint8_t *src_in, const uint8_t *mask) {
+    uint8_t src[CPU_LANES_MAX];
+    memcpy(src, src_in, sizeof(src));
+
+    LANES_FOR(i) dst[i] = mask[i] ? src[i] : dst[i];
+}
+
+SIMD_KERNEL
+static void lanes_alu(cpu_lanes_t *cpu, int kind, const uint8_t *src_in, const uint8_t *mask) {
+    uint8_t src[CPU_LANES_MAX];
+    memcpy(src, src_in, sizeof(src));
+
+    switch (kind) {
+        case 0: // add A, r
+        case 1: // adc A, r
+            LANES_FOR(i) {
+                uint8_t old = cpu->A[i];
+                uint8_t res = old + src[i] + (kind == 1 ? cpu->c[i] : 0);
+                uint8_t m = mask[i];
+
+                cpu->A[i] = m ? res : old;
+                cpu->z[i] = m ? res == 0 : cpu->z[i];
+                cpu->n[i] = m ? 0 : cpu->n[i];
+                cpu->h[i] = m ? res >= 0x10 && old < 0x10 : cpu->h[i];
+                cpu->c[i] = m ? res < old : cpu->c[i];
+            }
+            return;
+        case 2: // sub A, r
+        case 3: // sbc A, r
+            LANES_FOR(i) {
+                uint8_t old = cpu->A[i];
+                uint8_t res = old - src[i] - (kind == 3 ? cpu->c[i] : 0);
+                uint8_t m = mask[i];
+
+                cpu->A[i] = m ? res : old;
+                cpu->z[i] = m ? res == 0 : cpu->z[i];
+                cpu->n[i] = m ? 1 : cpu->n[i];
+                cpu->h[i] = m ? res <= 0x10 && old > 0x10 : cpu->h[i];
+                cpu->c[i] = m ? res > old : cpu->c[i];
+            }
+            return;
+        case 4: // and A, r
+        case 5: // xor A, r
+        case 6: // or A, r
+            LANES_FOR(i) {
+                uint8_t old = cpu->A[i];
+                uint8_t res = kind == 4 ? old & src[i] : kind == 5 ? old ^ src[i] : old | src[i];
+                uint8_t m = mask[i];
+
+                cpu->A[i] = m ? res : old;
+                cpu->z[i] = m ? res == 0 : cpu->z[i];
+                cpu->n[i] = m ? 0 : cpu->n[i];
+                cpu->h[i] = m ? kind == 4 : cpu->h[i];
+                cpu->c[i] = m ? 0 : cpu->c[i];
+            }
+            return;
+        case 7: // cp A, r
+            LANES_FOR(i) {
+                uint8_t old = cpu->A[i];
+                uint8_t would_be_a = cpu->n[i] - src[i];
+                uint8_t m = mask[i];
+
+                cpu->z[i] = m ? would_be_a == 0 : cpu->z[i];
+                cpu->n[i] = m ? 1 : cpu->n[i];
+                cpu->h[i] = m ? would_be_a <= 0x10 && old > 0x10 : cpu->h[i];
+                cpu->c[i] = m ? would_be_a > old : cpu->c[i];
+            }
+            return;
+    }
+}
+
+SIMD_KERNEL
+static void lanes_inc_dec(cpu_lanes_t *cpu, uint8_t *dst, int dec, const uint8_t *mask) {
+    LANES_FOR(i) {
+        uint8_t old = dst[i];
+        uint8_t res = dec ? old - 1 : old + 1;
+        uint8_t m = mask[i];
+
+        dst[i] = m ? res : old;
+        cpu->z[i] = m ? res == 0 : cpu->z[i];
+        cpu->n[i] = m ? dec : cpu->n[i];
+        cpu->h[i] = m ? (dec ? old >= 0x10 && res < 0x10 : old <= 0x10 && res > 0x10) : cpu->h[i];
+    }
+}
+
+SIMD_KERNEL
+static void lanes_advance(uint16_t *pc, uint64_t *cycles, uint64_t *instructions, const uint8_t *mask, int length,
+                          int timing) {
+    LANES_FOR(i) {
+        pc[i] += mask[i] ? length : 0;
+        cycles[i] += mask[i] ? timing : 0;
+        instructions[i] += mask[i] ? 1 : 0;
+    }
+}
+
+// Returns 0 if the opcode touches memory or control flow and has to go through cpu_tick.
+static int execute_vector(lockstep_t *ls, uint8_t opcode, const uint8_t *mask) {
+    cpu_lanes_t *cpu = &ls->cpu;
+
+    if (opcode >= 0x40 && opcode <= 0x7f) { // ld r, r'
+        uint8_t *dst = lane_register(cpu, opcode >> 3 & 0b111);
+        uint8_t *src = lane_register(cpu, opcode & 0b111);
+        if (dst == NULL || src == NULL) return 0;
+
+        lanes_move(dst, src, mask);
+    } else if (opcode >= 0x80 && opcode <= 0xbf) { // 8-bit arithmetic on registers
+        uint8_t *src = lane_register(cpu, opcode & 0b111);
+        if (src == NULL) return 0;
+
+        lanes_alu(cpu, opcode >> 3 & 0b111, src, mask);
+    } else if (opcode == 0x00) { // NOP
+    } else if ((opcode & 0b11000000) == 0 && (opcode & 0b111) >= 0b100 && (opcode & 0b111) <= 0b110) {
+        uint8_t *dst = lane_register(cpu, cpu_decode_acb(opcode));
+        if (dst == NULL) return 0;
+
+        if ((opcode & 0b111) == 0b110) { // ld r, n
+            uint8_t imm[CPU_LANES_MAX];
+
+            LANES_FOR(i) imm[i] = mask[i] ? bus_read(&ls->gb[i]->bus, cpu->PC[i] + 1) : 0;
+            lanes_move(dst, imm, mask);
+        } else { // inc r / dec r
+            lanes_inc_dec(cpu, dst, opcode & 0b1, mask);
+        }
+    } else {
+        return 0;
+    }
+
+    lanes_advance(cpu->PC, ls->cycles, ls->instructions, mask, cpu_ops[opcode].length, cpu_ops[opcode].timing);
+    return 1;
+}
+
+static void execute_scalar(lockstep_t *ls, int lane) {
+    gameboy_t *gb = ls->gb[lane];
+
+    cpu_lanes_store(&ls->cpu, lane, &gb->cpu);
+    gb->cycles = ls->cycles[lane];
+    gb->instructions = ls->instructions[lane];
+
+    gameboy_step(gb);
+
+    cpu_lanes_load(&ls->cpu, lane, &gb->cpu);
+    ls->cycles[lane] = gb->cycles;
+    ls->instructions[lane] = gb->instructions;
+    ls->joypad_stale[lane] = 1;
+}
+
+void lockstep_init(lockstep_t *ls, gameboy_t **instances, int count) {
+    memset(ls, 0, sizeof(lockstep_t));
+
+    ls->count = count > CPU_LANES_MAX ? CPU_LANES_MAX : count;
+    for (int i = 0; i < ls->count; i++) {
+        ls->gb[i] = instances[i];
+    }
+}
+
+void lockstep_run_frame(lockstep_t *ls) {
+    uint64_t frame_start[CPU_LANES_MAX];
+    uint64_t frame_end[CPU_LANES_MAX];
+    uint64_t mode_change[CPU_LANES_MAX];
+    uint8_t render[CPU_LANES_MAX];
+    uint8_t mask[CPU_LANES_MAX];
+    uint64_t begin = timeline_begin();
+
+    for (int i = 0; i < ls->count; i++) {
+        cpu_lanes_load(&ls->cpu, i, &ls->gb[i]->cpu);
+        ls->cycles[i] = ls->gb[i]->cycles;
+        ls->instructions[i] = ls->gb[i]->instructions;
+        ls->joypad_stale[i] = 1;
+        frame_start[i] = ls->gb[i]->frames * GAMEBOY_FRAME_CYCLES;
+        frame_end[i] = frame_start[i] + GAMEBOY_FRAME_CYCLES;
+        mode_change[i] = frame_start[i] + ls->gb[i]->ppu.next;
+        render[i] = (uint8_t) ppu_renders(&ls->gb[i]->ppu, ls->gb[i]->frames);
+    }
+
+    for (;;) {
+        int leader = -1;
+
+        for (int i = 0; i < ls->count; i++) {
+            if (ls->cycles[i] >= frame_end[i]) continue;
+
+            // Same point as in gameboy_run_frame(): before the lane's next instruction.
+            if (ls->cycles[i] >= mode_change[i]) {
+                uint32_t dot = (uint32_t) (ls->cycles[i] - frame_start[i]);
+                mode_change[i] = frame_start[i] + ppu_run(&ls->gb[i]->ppu, &ls->gb[i]->bus, dot, render[i]);
+            }
+
+            if (ls->cpu.halted[i] || ls->cpu.stopped[i]) { // Idles in 4 cycle steps until the frame is over.
+                ls->cycles[i] += (frame_end[i] - ls->cycles[i] + 3) / 4 * 4;
+                continue;
+            }
+
+            if (leader < 0 || ls->cycles[i] < ls->cycles[leader]) {
+                leader = i;
+            }
+        }
+
+        if (leader < 0) break;
+
+        uint16_t pc = ls->cpu.PC[leader];
+        uint8_t opcode = bus_read(&ls->gb[leader]->bus, pc);
+
+        memset(mask, 0, sizeof(mask));
+        for (int i = 0; i < ls->count; i++) {
+            mask[i] = ls->cycles[i] < frame_end[i] && !ls->cpu.halted[i] && !ls->cpu.stopped[i]
+                      && ls->cpu.PC[i] == pc && bus_read(&ls->gb[i]->bus, pc) == opcode;
+        }
+
+        // gameboy_step() refreshes the joypad register before every instruction. It's idempotent, so lanes only
+        // need it once after cpu_tick had a chance to write to it.
+        for (int i = 0; i < ls->count; i++) {
+            if (mask[i] && ls->joypad_stale[i]) {
+                gameboy_update_joypad(ls->gb[i]);
+                ls->joypad_stale[i] = 0;
+            }
+        }
+
+        if (execute_vector(ls, opcode, mask)) {
+            ls->vector_steps++;
+            continue;
+        }
+
+        for (int i = 0; i < ls->count; i++) {
+            if (mask[i]) execute_scalar(ls, i);
+        }
+
+        ls->scalar_steps++;
+    }
+
+    for (int i = 0; i < ls->count; i++) {
+        cpu_lanes_store(&ls->cpu, i, &ls->gb[i]->cpu);
+        ls->gb[i]->cycles = ls->cycles[i];
+        ls->gb[i]->instructions = ls->instructions[i];
+        ppu_end_frame(&ls->gb[i]->ppu, &ls->gb[i]->bus, render[i]);
+        ls->gb[i]->frames++;
+    }
+
+    timeline_end("lockstep", begin);
+}
+
+void lockstep_step_cpu(lockstep_t *ls) {
+    uint8_t pending[CPU_LANES_MAX];
+    uint8_t mask[CPU_LANES_MAX];
+
+    for (int i = 0; i < ls->count; i++) {
+        cpu_lanes_load(&ls->cpu, i, &ls->gb[i]->cpu);
+        ls->cycles[i] = ls->gb[i]->cycles;
+        ls->instructions[i] = ls->gb[i]->instructions;
+        pending[i] = !ls->cpu.halted[i] && !ls->cpu.stopped[i];
+    }
+
+    for (int leader = 0; leader < ls->count; leader++) {
+        if (!pending[leader]) continue;
+
+        uint16_t pc = ls->cpu.PC[leader];
+        uint8_t opcode = bus_read(&ls->gb[leader]->bus, pc);
+
+        memset(mask, 0, sizeof(mask));
+        for (int i = leader; i < ls->count; i++) {
+            mask[i] = pending[i] && ls->cpu.PC[i] == pc && bus_read(&ls->gb[i]->bus, pc) == opcode;
+            if (mask[i]) pending[i] = 0;
+        }
+
+        if (execute_vector(ls, opcode, mask)) {
+            ls->vector_steps++;
+            continue;
+        }
+
+        for (int i = leader; i < ls->count; i++) {
+            if (!mask[i]) continue;
+
+            gameboy_t *gb = ls->gb[i];
+            uint8_t cb = bus_read(&gb->bus, pc + 1);
+
+            cpu_lanes_store(&ls->cpu, i, &gb->cpu);
+            cpu_tick(&gb->cpu, &gb->bus);
+            cpu_lanes_load(&ls->cpu, i, &gb->cpu);
+            ls->cycles[i] += opcode == 0xcb ? cpu_cb_ops[cb].timing : cpu_ops[opcode].timing;
+            ls->instructions[i]++;
+        }
+
+        ls->scalar_steps++;
+    }
+
+    for (int i = 0; i < ls->count; i++) {
+        cpu_lanes_store(&ls->cpu, i, &ls->gb[i]->cpu);
+        ls->gb[i]->cycles = ls->cycles[i];
+        ls->gb[i]->instructions = ls->instructions[i];
+    }
+}
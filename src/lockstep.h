@@ -0,0 +1,34 @@
+#ifndef CGAMEBOY_LOCKSTEP_H
+#define CGAMEBOY_LOCKSTEP_H
+
+#include <stdint.h>
+
+#include "components/cpu_lanes.h"
+#include "gameboy.h"
+
+// Runs up to CPU_LANES_MAX instances of the same ROM in lockstep. Every step picks the lane that is furthest behind,
+// masks in all lanes sitting on the same opcode at the same PC and executes that opcode for all of them at once.
+// Register-only opcodes run vector-wide on the SoA registers, everything else falls back to cpu_tick per lane.
+// Lanes whose PC diverged are masked off and picked up by a later step. The instances are loaded into the lanes at the
+// start of every frame and written back at its end, so they can be inspected and fed input between frames.
+typedef struct {
+    int count;
+    gameboy_t *gb[CPU_LANES_MAX];
+
+    cpu_lanes_t cpu;
+    uint64_t cycles[CPU_LANES_MAX];
+    uint64_t instructions[CPU_LANES_MAX];
+    uint8_t joypad_stale[CPU_LANES_MAX];
+
+    uint64_t vector_steps;
+    uint64_t scalar_steps;
+} lockstep_t;
+
+void lockstep_init(lockstep_t *ls, gameboy_t **instances, int count);
+void lockstep_run_frame(lockstep_t *ls);
+
+// Executes exactly one instruction on every lane that isn't halted or stopped, without the joypad refresh, interrupt
+// handling and frame accounting of lockstep_run_frame(). Checks the vector paths instruction by instruction.
+void lockstep_step_cpu(lockstep_t *ls);
+
+#endif //CGAMEBOY_LOCKSTEP_H
@@ -1,13 +1,816 @@
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-#include "components/cpu.h"
+#include "asm.h"
+#include "batch.h"
+#include "bootcache.h"
+#include "coverage.h"
+#include "debugger.h"
+#include "explore.h"
+#include "forkserver.h"
+#include "gameboy.h"
+#include "input.h"
+#include "lockstep.h"
+#include "movie.h"
+#include "profile.h"
+#include "rewind.h"
+#include "scaler.h"
+#include "stats.h"
+#include "symprof.h"
+#include "testvec.h"
+#include "timeline.h"
+#include "trace.h"
+#include "video.h"
 
-int main() {
-    uint8_t mem[65536];
-    memset(mem, 0, 65536);
+static int usage(void) {
+    fprintf(stderr, "usage: CGameBoy run <rom> <frames> [input script]\n");
+    fprintf(stderr, "       CGameBoy batch <job list> [threads]\n");
+    fprintf(stderr, "       CGameBoy lockstep <rom> <frames> <input script>...\n");
+    fprintf(stderr, "       CGameBoy record <rom> <frames> <input script> <movie> [keyframe interval]\n");
+    fprintf(stderr, "       CGameBoy replay <movie> [frame]\n");
+    fprintf(stderr, "       CGameBoy rewind <rom> <frames> <input script|-> <frames back>\n");
+    fprintf(stderr, "       CGameBoy explore <rom> <frames per step> <max depth> <address> <value> [threads] [bfs|best] [max nodes]\n");
+    fprintf(stderr, "       CGameBoy cover <rom> <frames> <input script>...\n");
+    fprintf(stderr, "       CGameBoy symprof <rom> <frames> <sym file> [input script] [folded output]\n");
+    fprintf(stderr, "       CGameBoy debug <rom> <frames> <input script|-> <b|w><address>...\n");
+    fprintf(stderr, "       CGameBoy screenshot <rom> <frames> <input script|-> <pam> [scale|filter] [grey|dmg|pocket|cgb]\n");
+    fprintf(stderr, "       CGameBoy tracedump <trace> [records]\n");
+    fprintf(stderr, "       CGameBoy asm <source> <rom>\n");
+    fprintf(stderr, "       CGameBoy testvec <directory> [threads] [-v]\n");
+    fprintf(stderr, "       CGameBoy stats <shared memory name>\n");
+    fprintf(stderr, "       CGameBoy forkserver <rom> [warm-up frames] [max children]\n");
+    return 1;
+}
+
+// $CGB_PROFILE names the file the profiler report goes to, "-" meaning stderr. Returns NULL if profiling is off.
+static profile_t *profile_from_env(void) {
+    const char *path = getenv("CGB_PROFILE");
+    return path != NULL && path[0] != '\0' ? profile_create() : NULL;
+}
+
+static void profile_finish(profile_t *profile, const gameboy_t *gb) {
+    if (profile == NULL) return;
+
+    const char *path = getenv("CGB_PROFILE");
+    FILE *out = strcmp(path, "-") == 0 ? stderr : fopen(path, "w");
+
+    if (out == NULL) {
+        fprintf(stderr, "Couldn't write profile %s\n", path);
+    } else {
+        profile_report(profile, gb, out);
+        if (out != stderr) fclose(out);
+    }
+
+    profile_destroy(profile);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// input_script_run() with every frame timed and published.
+static void run_with_stats(const input_script_t *script, gameboy_t *gb, uint64_t frames, stats_t *stats) {
+    size_t next = 0;
+    uint64_t end = gb->frames + frames;
+
+    while (gb->frames < end) {
+        next = input_script_apply(script, next, gb);
+
+        uint64_t begin = now_ns();
+        gameboy_run_frame(gb);
+        stats_frame(stats, gb, now_ns() - begin);
+    }
+}
+
+static int run(int argc, char **argv) {
+    if (argc < 4) return usage();
+
+    size_t rom_size;
+    uint8_t *rom = gameboy_read_file(argv[2], &rom_size);
+    if (rom == NULL) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    input_script_t script = { NULL, 0 };
+    if (argc > 4 && input_script_load(&script, argv[4]) != 0) {
+        fprintf(stderr, "Couldn't read input script %s\n", argv[4]);
+        free(rom);
+        return 1;
+    }
+
+    gameboy_t *gb = gameboy_create();
+    cpu_probes_t probes = { NULL, 0, profile_from_env(), NULL, NULL, NULL, NULL, NULL };
+    const char *trace_path = getenv("CGB_TRACE");
+    int status = 0;
+
+    if (trace_path != NULL && trace_path[0] != '\0' && (probes.trace = trace_open(trace_path)) == NULL) {
+        fprintf(stderr, "Couldn't write trace %s\n", trace_path);
+        status = 1;
+    }
+
+    bootcache_reset(gb, rom, rom_size);
+    if (probes.profile != NULL || probes.trace != NULL) gameboy_set_probes(gb, &probes);
+
+    const char *stats_name = getenv("CGB_STATS_SHM");
+    stats_t *stats = NULL;
+
+    if (stats_name != NULL && stats_name[0] != '\0' && (stats = stats_open(stats_name, gb)) == NULL) {
+        fprintf(stderr, "Couldn't create stats segment %s\n", stats_name);
+        status = 1;
+    }
+
+    if (stats == NULL) {
+        input_script_run(&script, gb, strtoull(argv[3], NULL, 10));
+    } else {
+        run_with_stats(&script, gb, strtoull(argv[3], NULL, 10), stats);
+        stats_close(stats);
+    }
+
+    printf("%016" PRIx64 "\n", gameboy_hash(gb));
+
+    if (probes.trace != NULL && trace_close(probes.trace) != 0) {
+        fprintf(stderr, "Couldn't write trace %s\n", trace_path);
+        status = 1;
+    }
+
+    profile_finish(probes.profile, gb);
+    input_script_free(&script);
+    gameboy_destroy(gb);
+    free(rom);
+    return status;
+}
+
+// Runs one lane per input script in lockstep and prints the final hash of every lane.
+static int lockstep(int argc, char **argv) {
+    if (argc < 5) return usage();
+
+    int count = argc - 4 > CPU_LANES_MAX ? CPU_LANES_MAX : argc - 4;
+    uint64_t frames = strtoull(argv[3], NULL, 10);
+
+    size_t rom_size;
+    uint8_t *rom = gameboy_read_file(argv[2], &rom_size);
+    if (rom == NULL) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    gameboy_t *instances[CPU_LANES_MAX];
+    input_script_t scripts[CPU_LANES_MAX];
+    size_t next[CPU_LANES_MAX];
+    int status = 0;
+
+    for (int i = 0; i < count; i++) {
+        instances[i] = gameboy_create();
+        bootcache_reset(instances[i], rom, rom_size);
+        next[i] = 0;
+
+        if (input_script_load(&scripts[i], argv[4 + i]) != 0) {
+            fprintf(stderr, "Couldn't read input script %s\n", argv[4 + i]);
+            scripts[i].events = NULL;
+            scripts[i].count = 0;
+            status = 1;
+        }
+    }
+
+    lockstep_t *ls = malloc(sizeof(lockstep_t));
+    lockstep_init(ls, instances, count);
+
+    for (uint64_t frame = 0; frame < frames && status == 0; frame++) {
+        for (int i = 0; i < count; i++) {
+            next[i] = input_script_apply(&scripts[i], next[i], instances[i]);
+        }
+
+        lockstep_run_frame(ls);
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (status == 0) printf("%s %016" PRIx64 "\n", argv[4 + i], gameboy_hash(instances[i]));
+
+        input_script_free(&scripts[i]);
+        gameboy_destroy(instances[i]);
+    }
+
+    fprintf(stderr, "%" PRIu64 " vector steps, %" PRIu64 " scalar steps\n", ls->vector_steps, ls->scalar_steps);
+
+    free(ls);
+    free(rom);
+    return status;
+}
+
+static int record(int argc, char **argv) {
+    if (argc < 6) return usage();
+
+    size_t rom_size;
+    uint8_t *rom = gameboy_read_file(argv[2], &rom_size);
+    if (rom == NULL) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    input_script_t script;
+    if (input_script_load(&script, argv[4]) != 0) {
+        fprintf(stderr, "Couldn't read input script %s\n", argv[4]);
+        free(rom);
+        return 1;
+    }
+
+    gameboy_t *gb = gameboy_create();
+    movie_t *movie = movie_create(argc > 6 ? atoi(argv[6]) : 600);
+    uint64_t frames = strtoull(argv[3], NULL, 10);
+    size_t next = 0;
+
+    bootcache_reset(gb, rom, rom_size);
+    while (gb->frames < frames) {
+        next = input_script_apply(&script, next, gb);
+        movie_record_frame(movie, gb);
+    }
+
+    int status = movie_save(movie, argv[5]);
+    if (status != 0) fprintf(stderr, "Couldn't write %s\n", argv[5]);
+    else printf("%016" PRIx64 "\n", gameboy_hash(gb));
+
+    movie_free(movie);
+    input_script_free(&script);
+    gameboy_destroy(gb);
+    free(rom);
+    return status == 0 ? 0 : 1;
+}
+
+// Seeks to the given frame, or the end of the movie, and prints the state hash there.
+static int replay(int argc, char **argv) {
+    if (argc < 3) return usage();
+
+    movie_t *movie = movie_load(argv[2]);
+    if (movie == NULL) {
+        fprintf(stderr, "Couldn't read movie %s\n", argv[2]);
+        return 1;
+    }
+
+    gameboy_t *gb = gameboy_create();
+    uint64_t frame = argc > 3 ? strtoull(argv[3], NULL, 10) : movie->frame_count;
+
+    int status = movie_seek(movie, gb, frame);
+    if (status != 0) fprintf(stderr, "Frame %" PRIu64 " is outside of the movie\n", frame);
+    else printf("%016" PRIx64 "\n", gameboy_hash(gb));
+
+    movie_free(movie);
+    gameboy_destroy(gb);
+    return status == 0 ? 0 : 1;
+}
+
+#define REWIND_CAPACITY (32 << 20)
+#define REWIND_FRAMES 3600 // 60 seconds.
+#define REWIND_KEYFRAME_INTERVAL 60
+
+// Runs with every frame pushed into a rewind buffer, then steps back and prints the state hash there. It matches a
+// straight run of that many fewer frames.
+static int rewind_frames(int argc, char **argv) {
+    if (argc < 6) return usage();
+
+    size_t rom_size;
+    uint8_t *rom = gameboy_read_file(argv[2], &rom_size);
+    if (rom == NULL) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    input_script_t script = { NULL, 0 };
+    if (strcmp(argv[4], "-") != 0 && input_script_load(&script, argv[4]) != 0) {
+        fprintf(stderr, "Couldn't read input script %s\n", argv[4]);
+        free(rom);
+        return 1;
+    }
+
+    gameboy_t *gb = gameboy_create();
+    rewind_t *rw = rewind_create(REWIND_CAPACITY, REWIND_FRAMES, REWIND_KEYFRAME_INTERVAL);
+    uint64_t frames = strtoull(argv[3], NULL, 10);
+    size_t back = strtoull(argv[5], NULL, 10);
+    size_t next = 0;
+
+    bootcache_reset(gb, rom, rom_size);
+    while (gb->frames < frames) {
+        next = input_script_apply(&script, next, gb);
+        gameboy_run_frame(gb);
+        rewind_push(rw, gb);
+    }
+
+    int status = rewind_seek(rw, gb, back);
+    if (status != 0) fprintf(stderr, "Only %zu frames are kept\n", rewind_available(rw));
+    else printf("%016" PRIx64 "\n", gameboy_hash(gb));
+
+    rewind_destroy(rw);
+    input_script_free(&script);
+    gameboy_destroy(gb);
+    free(rom);
+    return status == 0 ? 0 : 1;
+}
+
+typedef struct {
+    uint16_t address;
+    uint8_t value;
+} explore_target_t;
+
+static int explore_goal(const gameboy_t *gb, void *ctx) {
+    const explore_target_t *target = ctx;
+    return bus_read(&gb->bus, target->address) == target->value;
+}
+
+static int64_t explore_score(const gameboy_t *gb, void *ctx) {
+    const explore_target_t *target = ctx;
+    return -abs((int) bus_read(&gb->bus, target->address) - (int) target->value);
+}
+
+#define EXPLORE_MAX_NODES 65536 // Sizes the fingerprint set to 32 MiB with the nine inputs below.
+
+// Searches for inputs that make the byte at address reach value and prints them as an input script.
+static int explore(int argc, char **argv) {
+    if (argc < 7) return usage();
+
+    size_t max_nodes = argc > 9 ? strtoull(argv[9], NULL, 10) : EXPLORE_MAX_NODES;
+    if (max_nodes == 0) return usage();
+
+    static const uint8_t inputs[] = {
+        0, JOYPAD_A, JOYPAD_B, JOYPAD_START, JOYPAD_SELECT, JOYPAD_RIGHT, JOYPAD_LEFT, JOYPAD_UP, JOYPAD_DOWN,
+    };
+
+    size_t rom_size;
+    uint8_t *rom = gameboy_read_file(argv[2], &rom_size);
+    if (rom == NULL) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    explore_target_t target = { (uint16_t) strtoul(argv[5], NULL, 0), (uint8_t) strtoul(argv[6], NULL, 0) };
+    explore_config_t config = {
+        argc > 8 && strcmp(argv[8], "best") == 0 ? EXPLORE_BEST_FIRST : EXPLORE_BREADTH_FIRST,
+        argc > 7 ? atoi(argv[7]) : 0,
+        (unsigned) strtoul(argv[3], NULL, 10),
+        inputs, sizeof(inputs),
+        strtoull(argv[4], NULL, 10),
+        max_nodes,
+        explore_goal, explore_score, &target,
+    };
+
+    gameboy_t *gb = gameboy_create();
+    bootcache_reset(gb, rom, rom_size);
+
+    explore_result_t result;
+    int status = explore_run(gb, &config, &result);
+
+    if (status == 0 && result.found) {
+        for (size_t i = 0; i < result.path_length; i++) {
+            char buttons[9];
+            input_format_buttons(result.path[i], buttons);
+            printf("%zu %s\n", i * config.frames_per_step, buttons);
+        }
+    } else if (status == 0) {
+        fprintf(stderr, "No input sequence reaches the target\n");
+        status = -1;
+    }
+
+    fprintf(stderr, "%zu expanded, %zu visited, %zu duplicates\n", result.expanded, result.visited, result.duplicates);
+
+    explore_result_free(&result);
+    gameboy_destroy(gb);
+    free(rom);
+    return status == 0 ? 0 : 1;
+}
+
+// Loads and warms up the ROM once, then forks a child per job line read from stdin.
+static int forkserver(int argc, char **argv) {
+    if (argc < 3) return usage();
+
+    size_t rom_size;
+    uint8_t *rom = gameboy_read_file(argv[2], &rom_size);
+    if (rom == NULL) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    gameboy_t *gb = gameboy_create();
+    bootcache_reset(gb, rom, rom_size);
+    input_script_run(NULL, gb, argc > 3 ? strtoull(argv[3], NULL, 10) : 0);
+
+    int status = forkserver_run(gb, stdin, stdout, argc > 4 ? atoi(argv[4]) : 0);
+
+    gameboy_destroy(gb);
+    free(rom);
+    return status == 0 ? 0 : 1;
+}
+
+// Runs every input script with edge coverage and prints "<script> <edges> <new buckets>", new meaning not reached by
+// any earlier script. The map is shared memory named by $CGB_COVERAGE_SHM if set.
+static int cover(int argc, char **argv) {
+    if (argc < 5) return usage();
+
+    size_t rom_size;
+    uint8_t *rom = gameboy_read_file(argv[2], &rom_size);
+    if (rom == NULL) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    cpu_probes_t probes = { coverage_map_open(getenv("CGB_COVERAGE_SHM")), 0, NULL, NULL, NULL, NULL, NULL, NULL };
+    uint8_t *seen = calloc(CPU_COVERAGE_SIZE, 1);
+    if (probes.coverage == NULL) {
+        fprintf(stderr, "Couldn't map the coverage map\n");
+        free(seen);
+        free(rom);
+        return 1;
+    }
+
+    gameboy_t *boot = gameboy_create();
+    bootcache_reset(boot, rom, rom_size);
+    gameboy_set_probes(boot, &probes);
+
+    uint64_t frames = strtoull(argv[3], NULL, 10);
+    int status = 0;
+
+    for (int i = 4; i < argc; i++) {
+        input_script_t script;
+        if (input_script_load(&script, argv[i]) != 0) {
+            fprintf(stderr, "Couldn't read input script %s\n", argv[i]);
+            status = 1;
+            continue;
+        }
+
+        memset(probes.coverage, 0, CPU_COVERAGE_SIZE);
+        probes.coverage_prev = 0;
+
+        gameboy_t *gb = gameboy_clone(boot);
+        input_script_run(&script, gb, frames);
+
+        printf("%s %zu %zu\n", argv[i], coverage_edges(probes.coverage), coverage_merge(seen, probes.coverage));
+
+        gameboy_destroy(gb);
+        input_script_free(&script);
+    }
+
+    gameboy_destroy(boot);
+    coverage_map_close(probes.coverage);
+    free(seen);
+    free(rom);
+    return status;
+}
+
+// Prints cycles per guest function and optionally writes folded stacks for flamegraph.pl.
+static int symprof(int argc, char **argv) {
+    if (argc < 5) return usage();
+
+    size_t rom_size;
+    uint8_t *rom = gameboy_read_file(argv[2], &rom_size);
+    if (rom == NULL) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    symbols_t symbols;
+    if (symbols_load(&symbols, argv[4]) != 0) {
+        fprintf(stderr, "Couldn't read symbol file %s\n", argv[4]);
+        free(rom);
+        return 1;
+    }
+
+    input_script_t script = { NULL, 0 };
+    if (argc > 5 && input_script_load(&script, argv[5]) != 0) {
+        fprintf(stderr, "Couldn't read input script %s\n", argv[5]);
+        symbols_free(&symbols);
+        free(rom);
+        return 1;
+    }
+
+    gameboy_t *gb = gameboy_create();
+    bootcache_reset(gb, rom, rom_size);
+
+    symprof_t *profiler = symprof_attach(gb, &symbols);
+    input_script_run(&script, gb, strtoull(argv[3], NULL, 10));
+    symprof_report(profiler, stdout);
+
+    int status = 0;
+    if (argc > 6) {
+        FILE *folded = fopen(argv[6], "w");
+
+        if (folded == NULL) {
+            fprintf(stderr, "Couldn't write %s\n", argv[6]);
+            status = 1;
+        } else {
+            symprof_write_folded(profiler, folded);
+            fclose(folded);
+        }
+    }
+
+    symprof_detach(profiler);
+    gameboy_destroy(gb);
+    input_script_free(&script);
+    symbols_free(&symbols);
+    free(rom);
+    return status;
+}
+
+// Runs with breakpoints (bXXXX) and write watchpoints (wXXXX) set, printing every stop.
+static int debug(int argc, char **argv) {
+    if (argc < 6) return usage();
+
+    size_t rom_size;
+    uint8_t *rom = gameboy_read_file(argv[2], &rom_size);
+    if (rom == NULL) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    input_script_t script = { NULL, 0 };
+    if (strcmp(argv[4], "-") != 0 && input_script_load(&script, argv[4]) != 0) {
+        fprintf(stderr, "Couldn't read input script %s\n", argv[4]);
+        free(rom);
+        return 1;
+    }
+
+    gameboy_t *gb = gameboy_create();
+    bootcache_reset(gb, rom, rom_size);
+
+    debugger_t *debugger = debugger_attach(gb);
+    int status = 0;
+
+    for (int i = 5; i < argc; i++) {
+        char *end;
+        unsigned long address = strtoul(argv[i] + 1, &end, 16);
+
+        if ((argv[i][0] != 'b' && argv[i][0] != 'w') || end == argv[i] + 1 || *end != '\0' || address > 0xffff) {
+            fprintf(stderr, "Invalid breakpoint %s\n", argv[i]);
+            status = 1;
+            break;
+        }
+
+        if (argv[i][0] == 'b') {
+            debugger_set_breakpoint(debugger, address, 1);
+        } else {
+            debugger_set_watchpoint(debugger, address, 1);
+        }
+    }
+
+    uint64_t end = gb->frames + strtoull(argv[3], NULL, 10);
+    size_t next = 0;
+
+    while (status == 0 && gb->frames < end) {
+        next = input_script_apply(&script, next, gb);
+        gameboy_run_frame(gb);
+
+        if (debugger->stop == DEBUGGER_BREAKPOINT) {
+            printf("break %04x frame %" PRIu64 " cycle %" PRIu64 "\n", debugger->pc, gb->frames, gb->cycles);
+        } else if (debugger->stop == DEBUGGER_WATCHPOINT) {
+            printf("watch %04x = %02x pc %04x frame %" PRIu64 " cycle %" PRIu64 "\n", debugger->address,
+                   bus_read(&gb->bus, debugger->address), debugger->pc, gb->frames, gb->cycles);
+        }
+    }
+
+    if (status == 0) printf("%016" PRIx64 "\n", gameboy_hash(gb));
+
+    debugger_detach(debugger);
+    gameboy_destroy(gb);
+    input_script_free(&script);
+    free(rom);
+    return status;
+}
+
+static const struct {
+    const char *name;
+    const video_palette_t *palette;
+} palettes[] = {
+    { "grey", &video_palette_grey }, { "dmg", &video_palette_dmg },
+    { "pocket", &video_palette_pocket }, { "cgb", &video_palette_cgb },
+};
+
+// Runs without rendering up to the last frame and writes that one as an RGBA PAM through the output stage, scaled up
+// either by nearest neighbour or one of the pixel art filters.
+static int screenshot(int argc, char **argv) {
+    if (argc < 6) return usage();
+
+    int scale = argc > 6 ? atoi(argv[6]) : 1;
+    int filter = -1;
+    const video_palette_t *palette = argc > 7 ? NULL : &video_palette_grey;
+
+    for (int i = 0; argc > 6 && i < SCALER_COUNT; i++) {
+        if (strcmp(argv[6], scaler_name(i)) == 0) {
+            filter = i;
+            scale = scaler_factor(i);
+        }
+    }
+
+    for (size_t i = 0; palette == NULL && i < sizeof(palettes) / sizeof(palettes[0]); i++) {
+        if (strcmp(argv[7], palettes[i].name) == 0) palette = palettes[i].palette;
+    }
+
+    if (scale < 1 || scale > VIDEO_SCALE_MAX || palette == NULL) return usage();
+
+    size_t rom_size;
+    uint8_t *rom = gameboy_read_file(argv[2], &rom_size);
+    if (rom == NULL) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    input_script_t script = { NULL, 0 };
+    if (strcmp(argv[4], "-") != 0 && input_script_load(&script, argv[4]) != 0) {
+        fprintf(stderr, "Couldn't read input script %s\n", argv[4]);
+        free(rom);
+        return 1;
+    }
+
+    gameboy_t *gb = gameboy_create();
+    uint8_t framebuffer[PPU_WIDTH * PPU_HEIGHT] = { 0 };
+    bootcache_reset(gb, rom, rom_size);
+
+    uint64_t end = gb->frames + strtoull(argv[3], NULL, 10);
+    size_t next = 0;
+
+    while (gb->frames < end) {
+        next = input_script_apply(&script, next, gb);
+        if (gb->frames + 1 == end) gameboy_set_render(gb, framebuffer, 1);
+
+        gameboy_run_frame(gb);
+    }
+
+    size_t pitch = PPU_WIDTH * scale * 4;
+    size_t size = pitch * PPU_HEIGHT * scale;
+    uint8_t *pixels = malloc(size);
+
+    if (filter < 0) {
+        video_convert(framebuffer, palette, VIDEO_RGBA8888, scale, pixels, pitch);
+    } else {
+        uint32_t *frame = malloc(PPU_WIDTH * PPU_HEIGHT * sizeof(uint32_t));
+        scaler_t *scaler = scaler_create(0);
+
+        video_convert(framebuffer, palette, VIDEO_RGBA8888, 1, frame, PPU_WIDTH * sizeof(uint32_t));
+        scaler_run(scaler, filter, frame, PPU_WIDTH * sizeof(uint32_t), (uint32_t *) pixels, pitch);
+
+        scaler_destroy(scaler);
+        free(frame);
+    }
+
+    FILE *out = fopen(argv[5], "wb");
+    int status = out == NULL
+                 || fprintf(out, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n",
+                            PPU_WIDTH * scale, PPU_HEIGHT * scale) < 0
+                 || fwrite(pixels, 1, size, out) != size;
+
+    if (out != NULL && fclose(out) != 0) status = 1;
+    if (status) fprintf(stderr, "Couldn't write %s\n", argv[5]);
+
+    free(pixels);
+    gameboy_destroy(gb);
+    input_script_free(&script);
+    free(rom);
+    return status;
+}
+
+// Assembles into a zero-filled 32 KiB ROM image.
+static int assemble(int argc, char **argv) {
+    if (argc < 4) return usage();
+
+    uint8_t *rom = calloc(1, GAMEBOY_ROM_SIZE);
+    asm_error_t error;
+
+    if (asm_assemble_file(argv[2], rom, GAMEBOY_ROM_SIZE, &error) < 0) {
+        if (error.line > 0) {
+            fprintf(stderr, "%s:%d: %s\n", argv[2], error.line, error.message);
+        } else {
+            fprintf(stderr, "%s\n", error.message);
+        }
+
+        free(rom);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[3], "wb");
+    int status = out == NULL || fwrite(rom, 1, GAMEBOY_ROM_SIZE, out) != GAMEBOY_ROM_SIZE;
+
+    if (out != NULL && fclose(out) != 0) status = 1;
+    if (status) fprintf(stderr, "Couldn't write %s\n", argv[3]);
+
+    free(rom);
+    return status;
+}
+
+static int dispatch(int argc, char **argv) {
+    if (argc < 2) return usage();
+
+    if (strcmp(argv[1], "run") == 0) {
+        return run(argc, argv);
+    }
+
+    if (strcmp(argv[1], "batch") == 0) {
+        if (argc < 3) return usage();
+
+        profile_t *profile = profile_from_env();
+        int status = batch_run(argv[2], argc > 3 ? atoi(argv[3]) : 0, stdout, profile);
+
+        profile_finish(profile, NULL);
+        return status == 0 ? 0 : 1;
+    }
+
+    if (strcmp(argv[1], "lockstep") == 0) {
+        return lockstep(argc, argv);
+    }
+
+    if (strcmp(argv[1], "record") == 0) {
+        return record(argc, argv);
+    }
+
+    if (strcmp(argv[1], "replay") == 0) {
+        return replay(argc, argv);
+    }
+
+    if (strcmp(argv[1], "rewind") == 0) {
+        return rewind_frames(argc, argv);
+    }
+
+    if (strcmp(argv[1], "explore") == 0) {
+        return explore(argc, argv);
+    }
+
+    if (strcmp(argv[1], "cover") == 0) {
+        return cover(argc, argv);
+    }
+
+    if (strcmp(argv[1], "symprof") == 0) {
+        return symprof(argc, argv);
+    }
+
+    if (strcmp(argv[1], "debug") == 0) {
+        return debug(argc, argv);
+    }
+
+    if (strcmp(argv[1], "screenshot") == 0) {
+        return screenshot(argc, argv);
+    }
+
+    if (strcmp(argv[1], "tracedump") == 0) {
+        if (argc < 3) return usage();
+
+        if (trace_dump(argv[2], stdout, argc > 3 ? strtoull(argv[3], NULL, 10) : 0) != 0) {
+            fprintf(stderr, "Couldn't read trace %s\n", argv[2]);
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if (strcmp(argv[1], "asm") == 0) {
+        return assemble(argc, argv);
+    }
+
+    if (strcmp(argv[1], "testvec") == 0) {
+        if (argc < 3) return usage();
+
+        int verbose = argc > 3 && strcmp(argv[argc - 1], "-v") == 0;
+        int threads = argc > 3 + verbose ? atoi(argv[3]) : 0;
+        int status = testvec_run(argv[2], threads, verbose, stdout);
+
+        if (status < 0) fprintf(stderr, "Couldn't read test vectors from %s\n", argv[2]);
+        return status == 0 ? 0 : 1;
+    }
+
+    if (strcmp(argv[1], "stats") == 0) {
+        if (argc < 3) return usage();
+
+        if (stats_dump(argv[2], stdout) != 0) {
+            fprintf(stderr, "No stats segment %s\n", argv[2]);
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if (strcmp(argv[1], "forkserver") == 0) {
+        return forkserver(argc, argv);
+    }
+
+    return usage();
+}
+
+// $CGB_TIMELINE names the file a Chrome trace of host time per subsystem goes to, for any subcommand.
+int main(int argc, char **argv) {
+    const char *timeline_path = getenv("CGB_TIMELINE");
+    int timeline = timeline_path != NULL && timeline_path[0] != '\0';
+
+    if (timeline && timeline_open(timeline_path) != 0) {
+        fprintf(stderr, "Couldn't open timeline %s\n", timeline_path);
+        return 1;
+    }
 
+    int status = dispatch(argc, argv);
 
+    if (timeline && timeline_close() != 0) {
+        fprintf(stderr, "Couldn't write timeline %s\n", timeline_path);
+        return 1;
+    }
 
-    return 0;
+    return status;
 }
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "movie.h"
+#include "savestate.h"
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t keyframe_interval;
+    uint32_t keyframe_count;
+    uint64_t frame_count;
+    uint64_t state_size;
+} movie_header_t;
+
+movie_t *movie_create(unsigned keyframe_interval) {
+    movie_t *movie = calloc(1, sizeof(movie_t));
+    movie->keyframe_interval = keyframe_interval ? keyframe_interval : 1;
+
+    return movie;
+}
+
+void movie_free(movie_t *movie) {
+    if (movie == NULL) return;
+
+    for (size_t i = 0; i < movie->keyframe_count; i++) {
+        free(movie->keyframes[i]);
+    }
+
+    free(movie->keyframes);
+    free(movie->inputs);
+    free(movie);
+}
+
+// Layout: header, one joypad byte per frame, then the keyframes in order.
+int movie_save(const movie_t *movie, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return -1;
+
+    movie_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MOVIE_MAGIC, 4);
+    header.version = MOVIE_VERSION;
+    header.keyframe_interval = movie->keyframe_interval;
+    header.keyframe_count = movie->keyframe_count;
+    header.frame_count = movie->frame_count;
+    header.state_size = savestate_size();
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1
+             && fwrite(movie->inputs, 1, movie->frame_count, file) == movie->frame_count;
+
+    for (size_t i = 0; ok && i < movie->keyframe_count; i++) {
+        ok = fwrite(movie->keyframes[i], savestate_size(), 1, file) == 1;
+    }
+
+    return fclose(file) == 0 && ok ? 0 : -1;
+}
+
+movie_t *movie_load(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    movie_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, MOVIE_MAGIC, 4) != 0
+        || header.version != MOVIE_VERSION
+        || header.state_size != savestate_size()
+        || header.keyframe_interval == 0
+        || header.keyframe_count == 0
+        || header.keyframe_count > header.frame_count / header.keyframe_interval + 1) {
+        fclose(file);
+        return NULL;
+    }
+
+    movie_t *movie = movie_create(header.keyframe_interval);
+    movie->inputs = malloc(header.frame_count ? header.frame_count : 1);
+    movie->input_capacity = header.frame_count;
+    movie->keyframes = calloc(header.keyframe_count, sizeof(uint8_t *));
+
+    int ok = fread(movie->inputs, 1, header.frame_count, file) == header.frame_count;
+    movie->frame_count = header.frame_count;
+
+    for (uint32_t i = 0; ok && i < header.keyframe_count; i++) {
+        movie->keyframes[i] = malloc(savestate_size());
+        movie->keyframe_count++;
+        ok = fread(movie->keyframes[i], savestate_size(), 1, file) == 1;
+    }
+
+    fclose(file);
+
+    if (!ok) {
+        movie_free(movie);
+        return NULL;
+    }
+
+    return movie;
+}
+
+void movie_record_frame(movie_t *movie, gameboy_t *gb) {
+    size_t frame = movie->frame_count;
+
+    if (frame % movie->keyframe_interval == 0) {
+        movie->keyframes = realloc(movie->keyframes, (movie->keyframe_count + 1) * sizeof(uint8_t *));
+        movie->keyframes[movie->keyframe_count] = malloc(savestate_size());
+        savestate_save(gb, movie->keyframes[movie->keyframe_count]);
+        movie->keyframe_count++;
+    }
+
+    if (frame == movie->input_capacity) {
+        movie->input_capacity = movie->input_capacity ? movie->input_capacity * 2 : 4096;
+        movie->inputs = realloc(movie->inputs, movie->input_capacity);
+    }
+
+    movie->inputs[frame] = gb->joypad;
+    movie->frame_count++;
+
+    gameboy_run_frame(gb);
+}
+
+int movie_play_frame(const movie_t *movie, gameboy_t *gb) {
+    if (gb->frames >= movie->frame_count) return -1;
+
+    gb->joypad = movie->inputs[gb->frames];
+    gameboy_run_frame(gb);
+
+    return 0;
+}
+
+int movie_seek(const movie_t *movie, gameboy_t *gb, uint64_t frame) {
+    if (frame > movie->frame_count || movie->keyframe_count == 0) return -1;
+
+    size_t keyframe = frame / movie->keyframe_interval;
+    if (keyframe >= movie->keyframe_count) keyframe = movie->keyframe_count - 1;
+
+    if (savestate_load(gb, movie->keyframes[keyframe], savestate_size()) != 0) return -1;
+
+    while (gb->frames < frame) {
+        movie_play_frame(movie, gb);
+    }
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef CGAMEBOY_MOVIE_H
+#define CGAMEBOY_MOVIE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "gameboy.h"
+
+#define MOVIE_MAGIC "CGBM"
+#define MOVIE_VERSION 1
+
+// Joypad input for every frame since power-on, plus a save state at the start of every keyframe_interval-th frame.
+// Frame numbers are the instance's frame counter, so a movie always starts at a freshly reset instance.
+typedef struct {
+    unsigned keyframe_interval;
+
+    uint8_t *inputs;
+    size_t frame_count;
+    size_t input_capacity;
+
+    uint8_t **keyframes;
+    size_t keyframe_count;
+} movie_t;
+
+movie_t *movie_create(unsigned keyframe_interval);
+void movie_free(movie_t *movie);
+
+int movie_save(const movie_t *movie, const char *path);
+movie_t *movie_load(const char *path);
+
+// Records the instance's current joypad state for its next frame, then runs that frame.
+void movie_record_frame(movie_t *movie, gameboy_t *gb);
+// Plays back the instance's next frame. Returns -1 past the end of the movie.
+int movie_play_frame(const movie_t *movie, gameboy_t *gb);
+// Restores the nearest keyframe at or before the given frame and runs forward to it.
+int movie_seek(const movie_t *movie, gameboy_t *gb, uint64_t frame);
+
+#endif //CGAMEBOY_MOVIE_H
@@ -0,0 +1,225 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+typedef struct {
+    pool_task_fn fn;
+    void *arg;
+} task_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    task_t *tasks;
+    size_t head;
+    size_t count;
+    size_t capacity;
+} deque_t;
+
+typedef struct {
+    pool_t *pool;
+    int id;
+} worker_arg_t;
+
+struct pool {
+    int size;
+    pthread_t *threads;
+    worker_arg_t *args;
+    deque_t *deques;
+
+    atomic_size_t queued;
+    atomic_size_t pending;
+    atomic_uint next_deque;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t idle;
+    int shutdown;
+};
+
+static _Thread_local pool_t *current_pool = NULL;
+static _Thread_local int current_worker = -1;
+
+static void deque_push(deque_t *deque, task_t task) {
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->count == deque->capacity) {
+        size_t capacity = deque->capacity ? deque->capacity * 2 : 64;
+        task_t *tasks = malloc(capacity * sizeof(task_t));
+
+        for (size_t i = 0; i < deque->count; i++) {
+            tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+        }
+
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->head = 0;
+        deque->capacity = capacity;
+    }
+
+    deque->tasks[(deque->head + deque->count) % deque->capacity] = task;
+    deque->count++;
+
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static int deque_pop_newest(deque_t *deque, task_t *task) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->count > 0) {
+        deque->count--;
+        *task = deque->tasks[(deque->head + deque->count) % deque->capacity];
+        found = 1;
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int deque_steal_oldest(deque_t *deque, task_t *task) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->count > 0) {
+        *task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->count--;
+        found = 1;
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int take_task(pool_t *pool, int id, task_t *task) {
+    if (deque_pop_newest(&pool->deques[id], task)) return 1;
+
+    for (int i = 1; i < pool->size; i++) {
+        if (deque_steal_oldest(&pool->deques[(id + i) % pool->size], task)) return 1;
+    }
+
+    return 0;
+}
+
+static void *worker_main(void *data) {
+    worker_arg_t *arg = data;
+    pool_t *pool = arg->pool;
+    task_t task;
+
+    current_pool = pool;
+    current_worker = arg->id;
+
+    for (;;) {
+        if (take_task(pool, arg->id, &task)) {
+            atomic_fetch_sub(&pool->queued, 1);
+            task.fn(task.arg, arg->id);
+
+            if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+                pthread_mutex_lock(&pool->lock);
+                pthread_cond_broadcast(&pool->idle);
+                pthread_mutex_unlock(&pool->lock);
+            }
+
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->queued) == 0 && !pool->shutdown) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+
+        int done = pool->shutdown && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (done) break;
+    }
+
+    return NULL;
+}
+
+pool_t *pool_create(int workers) {
+    if (workers <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = online > 0 ? (int) online : 1;
+    }
+
+    pool_t *pool = calloc(1, sizeof(pool_t));
+    pool->size = workers;
+    pool->threads = calloc(workers, sizeof(pthread_t));
+    pool->args = calloc(workers, sizeof(worker_arg_t));
+    pool->deques = calloc(workers, sizeof(deque_t));
+
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->next_deque, 0);
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    for (int i = 0; i < workers; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    for (int i = 0; i < workers; i++) {
+        pool->args[i].pool = pool;
+        pool->args[i].id = i;
+        pthread_create(&pool->threads[i], NULL, worker_main, &pool->args[i]);
+    }
+
+    return pool;
+}
+
+void pool_destroy(pool_t *pool) {
+    pool_wait(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->size; i++) {
+        pthread_join(pool->threads[i], NULL);
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->idle);
+
+    free(pool->deques);
+    free(pool->args);
+    free(pool->threads);
+    free(pool);
+}
+
+int pool_size(const pool_t *pool) {
+    return pool->size;
+}
+
+void pool_submit(pool_t *pool, pool_task_fn fn, void *arg) {
+    int id = current_pool == pool
+             ? current_worker
+             : (int) (atomic_fetch_add(&pool->next_deque, 1) % (unsigned) pool->size);
+
+    atomic_fetch_add(&pool->pending, 1);
+    deque_push(&pool->deques[id], (task_t) { fn, arg });
+    atomic_fetch_add(&pool->queued, 1);
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Blocks until every submitted task, including the ones submitted by other tasks, has finished.
+void pool_wait(pool_t *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&pool->pending) != 0) {
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
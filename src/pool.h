@@ -0,0 +1,18 @@
+#ifndef CGAMEBOY_POOL_H
+#define CGAMEBOY_POOL_H
+
+typedef void (*pool_task_fn)(void *arg, int worker);
+
+typedef struct pool pool_t;
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own newest task and steals the oldest task of
+// another worker once its own deque runs dry. Tasks submitted from inside a task go to the submitting worker's deque.
+pool_t *pool_create(int workers);
+void pool_destroy(pool_t *pool);
+
+int pool_size(const pool_t *pool);
+
+void pool_submit(pool_t *pool, pool_task_fn fn, void *arg);
+void pool_wait(pool_t *pool);
+
+#endif //CGAMEBOY_POOL_H
@@ -0,0 +1,125 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+#define PROFILE_TOP_PCS 32
+
+typedef struct {
+    uint32_t key;
+    uint64_t count;
+    uint64_t cycles;
+} row_t;
+
+profile_t *profile_create(void) {
+    return calloc(1, sizeof(profile_t));
+}
+
+void profile_destroy(profile_t *profile) {
+    free(profile);
+}
+
+void profile_merge(profile_t *dst, const profile_t *src) {
+    for (int i = 0; i < 256; i++) {
+        dst->op_count[i] += src->op_count[i];
+        dst->op_cycles[i] += src->op_cycles[i];
+        dst->cb_count[i] += src->cb_count[i];
+        dst->cb_cycles[i] += src->cb_cycles[i];
+    }
+
+    for (int i = 0; i < GAMEBOY_MEM_SIZE; i++) {
+        dst->pc_count[i] += src->pc_count[i];
+        dst->pc_cycles[i] += src->pc_cycles[i];
+    }
+
+    dst->idle_cycles += src->idle_cycles;
+}
+
+static int by_cycles(const void *a, const void *b) {
+    const row_t *x = a;
+    const row_t *y = b;
+
+    if (x->cycles != y->cycles) return x->cycles < y->cycles ? 1 : -1;
+    return x->key < y->key ? -1 : x->key > y->key;
+}
+
+static size_t collect(row_t *rows, const uint64_t *count, const uint64_t *cycles, size_t size) {
+    size_t used = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        if (count[i] == 0) continue;
+
+        rows[used].key = (uint32_t) i;
+        rows[used].count = count[i];
+        rows[used].cycles = cycles[i];
+        used++;
+    }
+
+    qsort(rows, used, sizeof(row_t), by_cycles);
+    return used;
+}
+
+static const char *op_name(const op_t *table, uint8_t opcode) {
+    return table[opcode].name != NULL ? table[opcode].name : "(illegal)";
+}
+
+static void report_ops(FILE *out, const char *title, const char *prefix, const op_t *table,
+                       const uint64_t *count, const uint64_t *cycles, uint64_t total) {
+    row_t rows[256];
+    size_t used = collect(rows, count, cycles, 256);
+
+    fprintf(out, "\n%s\n%14s %7s %14s  %-8s %s\n", title, "cycles", "%", "count", "opcode", "name");
+
+    for (size_t i = 0; i < used; i++) {
+        fprintf(out, "%14" PRIu64 " %6.2f%% %14" PRIu64 "  %s%02x     %s\n", rows[i].cycles,
+                total ? 100.0 * (double) rows[i].cycles / (double) total : 0.0, rows[i].count,
+                prefix, rows[i].key, op_name(table, (uint8_t) rows[i].key));
+    }
+}
+
+// ROM below 0x4000 is always bank 0, and without an MBC the switchable area is fixed to bank 1.
+static void format_location(char *text, size_t size, uint16_t pc) {
+    if (pc < 0x4000) snprintf(text, size, "00:%04x", pc);
+    else if (pc < 0x8000) snprintf(text, size, "01:%04x", pc);
+    else snprintf(text, size, "--:%04x", pc);
+}
+
+void profile_report(const profile_t *profile, const gameboy_t *gb, FILE *out) {
+    uint64_t instructions = 0;
+    uint64_t total = profile->idle_cycles;
+
+    for (int i = 0; i < 256; i++) {
+        instructions += profile->op_count[i] + profile->cb_count[i];
+        total += profile->op_cycles[i] + profile->cb_cycles[i];
+    }
+
+    fprintf(out, "%" PRIu64 " instructions, %" PRIu64 " cycles, %" PRIu64 " idle cycles\n",
+            instructions, total, profile->idle_cycles);
+
+    report_ops(out, "Opcodes", "", cpu_ops, profile->op_count, profile->op_cycles, total);
+    report_ops(out, "CB opcodes", "cb", cpu_cb_ops, profile->cb_count, profile->cb_cycles, total);
+
+    row_t *rows = malloc(GAMEBOY_MEM_SIZE * sizeof(row_t));
+    size_t used = collect(rows, profile->pc_count, profile->pc_cycles, GAMEBOY_MEM_SIZE);
+
+    fprintf(out, "\nTop PCs\n%14s %7s %14s  %-8s %s\n", "cycles", "%", "count", "bank:pc", "name");
+
+    for (size_t i = 0; i < used && i < PROFILE_TOP_PCS; i++) {
+        char location[16];
+        uint16_t pc = (uint16_t) rows[i].key;
+        const char *name = "";
+
+        format_location(location, sizeof(location), pc);
+
+        if (gb != NULL) {
+            uint8_t opcode = bus_read(&gb->bus, pc);
+            name = opcode == 0xcb ? op_name(cpu_cb_ops, bus_read(&gb->bus, pc + 1)) : op_name(cpu_ops, opcode);
+        }
+
+        fprintf(out, "%14" PRIu64 " %6.2f%% %14" PRIu64 "  %s  %s\n", rows[i].cycles,
+                total ? 100.0 * (double) rows[i].cycles / (double) total : 0.0, rows[i].count, location, name);
+    }
+
+    free(rows);
+}
@@ -0,0 +1,45 @@
+#ifndef CGAMEBOY_PROFILE_H
+#define CGAMEBOY_PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gameboy.h"
+
+// Execution counts and T-cycles per opcode, per CB opcode and per PC. Plain counters without any synchronisation, so
+// every thread profiles into its own profile_t and they get merged afterwards.
+struct profile {
+    uint64_t op_count[256];
+    uint64_t op_cycles[256];
+    uint64_t cb_count[256];
+    uint64_t cb_cycles[256];
+
+    uint64_t pc_count[GAMEBOY_MEM_SIZE];
+    uint64_t pc_cycles[GAMEBOY_MEM_SIZE];
+
+    uint64_t idle_cycles; // Spent halted or stopped.
+};
+
+profile_t *profile_create(void);
+void profile_destroy(profile_t *profile);
+
+void profile_merge(profile_t *dst, const profile_t *src);
+
+// Writes the opcode tables and the top PCs, all sorted by cycles. gb is optional and only used to name the
+// instruction at each PC.
+void profile_report(const profile_t *profile, const gameboy_t *gb, FILE *out);
+
+static inline void profile_record(profile_t *profile, uint16_t pc, uint8_t opcode, uint8_t cb_opcode, int cycles) {
+    profile->pc_count[pc]++;
+    profile->pc_cycles[pc] += cycles;
+
+    if (opcode == 0xcb) {
+        profile->cb_count[cb_opcode]++;
+        profile->cb_cycles[cb_opcode] += cycles;
+    } else {
+        profile->op_count[opcode]++;
+        profile->op_cycles[opcode] += cycles;
+    }
+}
+
+#endif //CGAMEBOY_PROFILE_H
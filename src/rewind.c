@@ -0,0 +1,272 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "rewind.h"
+#include "savestate.h"
+#include "timeline.h"
+
+typedef struct {
+    size_t offset;
+    size_t size;
+    int keyframe;
+} entry_t;
+
+struct rewind {
+    uint8_t *data;
+    size_t capacity;
+    size_t head;
+
+    entry_t *entries;
+    size_t max_entries;
+    size_t first;
+    size_t count;
+
+    unsigned keyframe_interval;
+    size_t since_keyframe;
+
+    size_t state_size;
+    uint8_t *state;   // Full state of the last pushed frame, the base of the next delta.
+    uint8_t *scratch; // Encoded delta before it's copied into the ring.
+    int state_valid;  // Cleared until the first push, and by a failed seek.
+    uint64_t page_hash[BUS_PAGE_COUNT]; // The bus' page hashes as of the last push.
+};
+
+static entry_t *entry_at(rewind_t *rw, size_t index) {
+    return &rw->entries[(rw->first + index) % rw->max_entries];
+}
+
+// Drops the oldest keyframe together with every delta depending on it.
+static void drop_oldest(rewind_t *rw) {
+    do {
+        rw->first = (rw->first + 1) % rw->max_entries;
+        rw->count--;
+    } while (rw->count > 0 && !entry_at(rw, 0)->keyframe);
+
+    if (rw->count == 0) rw->head = 0;
+}
+
+// Finds room for size contiguous bytes, evicting old frames as needed. Returns the offset to write to.
+static size_t reserve(rewind_t *rw, size_t size) {
+    while (rw->count > 0) {
+        size_t oldest = entry_at(rw, 0)->offset;
+
+        if (rw->count < rw->max_entries) {
+            if (rw->head > oldest) {
+                if (rw->capacity - rw->head >= size) return rw->head;
+                if (oldest >= size) return 0;
+            } else if (oldest - rw->head >= size) {
+                return rw->head;
+            }
+        }
+
+        drop_oldest(rw);
+    }
+
+    return 0;
+}
+
+// Fails for a delta if making room evicted the keyframe it is based on.
+static int append(rewind_t *rw, const uint8_t *data, size_t size, int keyframe) {
+    size_t offset = reserve(rw, size);
+    if (!keyframe && rw->count == 0) return -1;
+
+    memcpy(rw->data + offset, data, size);
+
+    *entry_at(rw, rw->count) = (entry_t) { offset, size, keyframe };
+    rw->count++;
+
+    rw->head = offset + size;
+    if (rw->head == rw->capacity) rw->head = 0;
+
+    return 0;
+}
+
+// Delta layout: the save state header, then per changed page its index, the length of its runs and the runs. A run is
+// a count of unchanged bytes, a count of changed bytes and the XOR of the changed bytes.
+static size_t encode_page(uint8_t *out, int page, const uint8_t *old_page, const uint8_t *new_page) {
+    size_t pos = 3;
+    int i = 0;
+
+    out[0] = page;
+
+    while (i < BUS_PAGE_SIZE) {
+        int skip = 0;
+        while (i < BUS_PAGE_SIZE && skip < 255 && old_page[i] == new_page[i]) {
+            skip++;
+            i++;
+        }
+
+        int literal = 0;
+        uint8_t *run = out + pos;
+        while (i + literal < BUS_PAGE_SIZE && literal < 255 && old_page[i + literal] != new_page[i + literal]) {
+            run[2 + literal] = old_page[i + literal] ^ new_page[i + literal];
+            literal++;
+        }
+
+        run[0] = skip;
+        run[1] = literal;
+        pos += 2 + literal;
+        i += literal;
+    }
+
+    out[1] = (pos - 3) & 0xff;
+    out[2] = (pos - 3) >> 8;
+    return pos;
+}
+
+// Brings rw->state up to the instance and, with out set, encodes the delta. Only pages written since the last push can
+// differ: those still marked dirty, and those whose hash changed if someone else fingerprinted the bus in between.
+// Returns the delta size, 0 without out or if it would exceed limit. The state is updated either way.
+static size_t update_state(rewind_t *rw, gameboy_t *gb, uint8_t *out, size_t limit) {
+    bus_t *bus = &gb->bus;
+    uint8_t *mem = rw->state + sizeof(savestate_header_t);
+    size_t size = sizeof(savestate_header_t);
+    uint8_t changed[BUS_PAGE_COUNT];
+    uint64_t root[2];
+
+    for (int page = 0; page < BUS_PAGE_COUNT; page++) {
+        changed[page] = bus->dirty[page] || bus->page_hash[page] != rw->page_hash[page];
+    }
+
+    // Clears the dirty marks for the next push, rehashing only the pages we look at anyway.
+    bus_fingerprint(bus, root);
+    memcpy(rw->page_hash, bus->page_hash, sizeof(rw->page_hash));
+
+    savestate_header_t header;
+    savestate_header(gb, &header);
+    memcpy(rw->state, &header, sizeof(header));
+    if (out != NULL) memcpy(out, &header, sizeof(header));
+
+    for (int page = 0; page < BUS_PAGE_COUNT; page++) {
+        uint8_t *old_page = mem + page * BUS_PAGE_SIZE;
+        const uint8_t *new_page = bus->read[page];
+
+        if (!changed[page] || memcmp(old_page, new_page, BUS_PAGE_SIZE) == 0) continue;
+
+        // Generous upper bound for one encoded page: every run costs two bytes plus its changed bytes.
+        if (out != NULL && size + 3 + 3 * BUS_PAGE_SIZE <= limit) {
+            size += encode_page(out + size, page, old_page, new_page);
+        } else {
+            out = NULL;
+        }
+
+        memcpy(old_page, new_page, BUS_PAGE_SIZE);
+    }
+
+    return out != NULL ? size : 0;
+}
+
+static void apply_delta(uint8_t *state, const uint8_t *delta, size_t size) {
+    size_t pos = sizeof(savestate_header_t);
+    memcpy(state, delta, pos);
+
+    uint8_t *mem = state + sizeof(savestate_header_t);
+
+    while (pos < size) {
+        uint8_t *page = mem + delta[pos] * BUS_PAGE_SIZE;
+        size_t end = pos + 3 + (delta[pos + 1] | delta[pos + 2] << 8);
+        int i = 0;
+
+        pos += 3;
+        while (pos < end) {
+            int literal = delta[pos + 1];
+
+            i += delta[pos];
+            for (int j = 0; j < literal; j++) {
+                page[i++] ^= delta[pos + 2 + j];
+            }
+
+            pos += 2 + literal;
+        }
+    }
+}
+
+rewind_t *rewind_create(size_t capacity, size_t max_frames, unsigned keyframe_interval) {
+    size_t state_size = savestate_size();
+    if (capacity < 2 * state_size || max_frames == 0) return NULL;
+
+    rewind_t *rw = calloc(1, sizeof(rewind_t));
+    rw->data = malloc(capacity);
+    rw->capacity = capacity;
+    rw->entries = calloc(max_frames, sizeof(entry_t));
+    rw->max_entries = max_frames;
+    rw->keyframe_interval = keyframe_interval ? keyframe_interval : 1;
+    rw->state_size = state_size;
+    rw->state = malloc(state_size);
+    rw->scratch = malloc(state_size);
+
+    return rw;
+}
+
+void rewind_destroy(rewind_t *rw) {
+    if (rw == NULL) return;
+
+    free(rw->data);
+    free(rw->entries);
+    free(rw->state);
+    free(rw->scratch);
+    free(rw);
+}
+
+int rewind_push(rewind_t *rw, gameboy_t *gb) {
+    uint64_t begin = timeline_begin();
+    int delta = rw->state_valid && rw->count > 0 && rw->since_keyframe < rw->keyframe_interval;
+    size_t delta_size = 0;
+
+    if (rw->state_valid) {
+        delta_size = update_state(rw, gb, delta ? rw->scratch : NULL, rw->state_size);
+    } else {
+        uint64_t root[2];
+
+        bus_fingerprint(&gb->bus, root);
+        memcpy(rw->page_hash, gb->bus.page_hash, sizeof(rw->page_hash));
+        savestate_save(gb, rw->state);
+        rw->state_valid = 1;
+    }
+
+    if (delta_size != 0 && append(rw, rw->scratch, delta_size, 0) == 0) {
+        rw->since_keyframe++;
+    } else { // Due for a keyframe, the delta wouldn't be smaller, or its base got evicted.
+        append(rw, rw->state, rw->state_size, 1);
+        rw->since_keyframe = 1;
+    }
+
+    timeline_end("rewind push", begin);
+    return 0;
+}
+
+int rewind_seek(rewind_t *rw, gameboy_t *gb, size_t frames_back) {
+    if (frames_back >= rw->count) return -1;
+
+    uint64_t begin = timeline_begin();
+    size_t target = rw->count - 1 - frames_back;
+    size_t keyframe = target;
+    while (!entry_at(rw, keyframe)->keyframe) keyframe--;
+
+    entry_t *entry = entry_at(rw, keyframe);
+    memcpy(rw->state, rw->data + entry->offset, rw->state_size);
+
+    for (size_t i = keyframe + 1; i <= target; i++) {
+        entry = entry_at(rw, i);
+        apply_delta(rw->state, rw->data + entry->offset, entry->size);
+    }
+
+    // Loading marks every page dirty, so the next push compares them all against the restored state.
+    if (savestate_load(gb, rw->state, rw->state_size) != 0) {
+        rw->state_valid = 0;
+        return -1;
+    }
+
+    entry = entry_at(rw, target);
+    rw->count = target + 1;
+    rw->head = entry->offset + entry->size;
+    if (rw->head == rw->capacity) rw->head = 0;
+    rw->since_keyframe = target - keyframe + 1;
+
+    timeline_end("rewind seek", begin);
+    return 0;
+}
+
+size_t rewind_available(const rewind_t *rw) {
+    return rw->count;
+}
@@ -0,0 +1,26 @@
+#ifndef CGAMEBOY_REWIND_H
+#define CGAMEBOY_REWIND_H
+
+#include <stddef.h>
+
+#include "gameboy.h"
+
+typedef struct rewind rewind_t;
+
+// Keeps the most recent frames in one fixed-size buffer: a full save state every keyframe_interval frames, and an
+// XOR/RLE delta of the memory pages that changed since the previous frame for every frame in between. When the buffer
+// or the frame limit is exhausted, the oldest keyframe and its deltas are dropped together. The capacity has to hold
+// at least two keyframes.
+rewind_t *rewind_create(size_t capacity, size_t max_frames, unsigned keyframe_interval);
+void rewind_destroy(rewind_t *rw);
+
+// Records the state at the end of a frame. Only pages written since the previous push are compared, which fingerprints
+// the bus to take its dirty marks.
+int rewind_push(rewind_t *rw, gameboy_t *gb);
+
+// Restores the state recorded frames_back pushes ago (0 = the latest one) and forgets everything after it.
+int rewind_seek(rewind_t *rw, gameboy_t *gb, size_t frames_back);
+
+size_t rewind_available(const rewind_t *rw);
+
+#endif //CGAMEBOY_REWIND_H
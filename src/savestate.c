@@ -0,0 +1,65 @@
+#include <string.h>
+
+#include "savestate.h"
+#include "timeline.h"
+
+_Static_assert(sizeof(((cpu_t *) 0)->registers) == 12, "register file must be 12 bytes");
+
+size_t savestate_size(void) {
+    return sizeof(savestate_header_t) + GAMEBOY_MEM_SIZE;
+}
+
+void savestate_header(const gameboy_t *gb, savestate_header_t *header) {
+    memset(header, 0, sizeof(*header));
+
+    memcpy(header->magic, SAVESTATE_MAGIC, 4);
+    header->version = SAVESTATE_VERSION;
+    header->header_size = sizeof(savestate_header_t);
+    header->size = (uint32_t) savestate_size();
+
+    memcpy(header->registers, &gb->cpu.registers, sizeof(header->registers));
+    header->cpu_state = gb->cpu.state.IME | gb->cpu.state.halted << 1 | gb->cpu.state.stopped << 2;
+    header->joypad = gb->joypad;
+    header->ppu_next = gb->ppu.next;
+    header->window_line = gb->ppu.window_line;
+    header->cycles = gb->cycles;
+    header->frames = gb->frames;
+}
+
+void savestate_save(const gameboy_t *gb, uint8_t *buffer) {
+    uint64_t begin = timeline_begin();
+    savestate_header_t header;
+    savestate_header(gb, &header);
+    memcpy(buffer, &header, sizeof(header));
+    bus_copy_out(&gb->bus, 0, buffer + sizeof(header), GAMEBOY_MEM_SIZE);
+    timeline_end("save state", begin);
+}
+
+// Returns -1 and leaves the instance untouched if the buffer isn't a save state of this version.
+int savestate_load(gameboy_t *gb, const uint8_t *buffer, size_t size) {
+    savestate_header_t header;
+
+    if (size < savestate_size()) return -1;
+    memcpy(&header, buffer, sizeof(header));
+
+    if (memcmp(header.magic, SAVESTATE_MAGIC, 4) != 0) return -1;
+    if (header.version != SAVESTATE_VERSION) return -1;
+    if (header.header_size != sizeof(savestate_header_t) || header.size != savestate_size()) return -1;
+    if (header.ppu_next > PPU_FRAME_CYCLES) return -1;
+
+    uint64_t begin = timeline_begin();
+
+    memcpy(&gb->cpu.registers, header.registers, sizeof(header.registers));
+    gb->cpu.state.IME = header.cpu_state & 0b001;
+    gb->cpu.state.halted = header.cpu_state >> 1 & 0b001;
+    gb->cpu.state.stopped = header.cpu_state >> 2 & 0b001;
+    gb->joypad = header.joypad;
+    gb->ppu.next = header.ppu_next;
+    gb->ppu.window_line = header.window_line;
+    gb->cycles = header.cycles;
+    gb->frames = header.frames;
+
+    bus_copy_in(&gb->bus, 0, buffer + sizeof(header), GAMEBOY_MEM_SIZE);
+    timeline_end("load state", begin);
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef CGAMEBOY_SAVESTATE_H
+#define CGAMEBOY_SAVESTATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "gameboy.h"
+
+#define SAVESTATE_MAGIC "CGBS"
+#define SAVESTATE_VERSION 2
+
+// Fixed-size header in front of the memory image. Multi-byte fields are in host byte order.
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t size;
+    uint32_t ppu_next;
+
+    uint8_t registers[12];
+    uint8_t cpu_state;
+    uint8_t joypad;
+    uint8_t window_line;
+    uint8_t padding;
+
+    uint64_t cycles;
+    uint64_t frames;
+} savestate_header_t;
+
+// A save state is the header followed by the full 64 KiB memory image, always savestate_size() bytes. Saving and
+// loading never allocate, callers keep one buffer around and reuse it.
+size_t savestate_size(void);
+
+// Just the header of the instance's save state, for callers that keep the memory image up to date themselves.
+void savestate_header(const gameboy_t *gb, savestate_header_t *header);
+void savestate_save(const gameboy_t *gb, uint8_t *buffer);
+int savestate_load(gameboy_t *gb, const uint8_t *buffer, size_t size);
+
+#endif //CGAMEBOY_SAVESTATE_H
@@ -0,0 +1,356 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "components/ppu.h"
+#include "pool.h"
+#include "scaler.h"
+#include "simd.h"
+#include "timeline.h"
+
+// Frames are copied into buffers with a border of repeated edge pixels, so the kernels never check bounds.
+#define SCALER_BORDER 2
+#define SCALER_STRIPS_PER_WORKER 2
+#define SCALER_FACTOR_MAX 4
+
+#define SCALER_STRIDE(width) ((width) + 2 * SCALER_BORDER)
+#define SCALER_PADDED_SIZE(width, height) ((size_t) SCALER_STRIDE(width) * ((height) + 2 * SCALER_BORDER))
+
+// Filters one source row (width pixels, stride pixels between rows) into factor rows of dst.
+typedef void (*scaler_row_fn)(const scaler_t *scaler, const uint32_t *src, ptrdiff_t stride, int width, uint32_t *dst,
+                              size_t pitch);
+
+typedef struct {
+    scaler_row_fn row;
+    const uint32_t *src; // First pixel inside the border.
+    ptrdiff_t stride;
+    int width;
+    int height;
+    int factor;
+    uint32_t *dst;
+    size_t pitch;
+} scaler_pass_t;
+
+typedef struct {
+    scaler_t *scaler;
+    int index;
+} scaler_strip_t;
+
+struct scaler {
+    pool_t *pool;
+    int strip_count;
+    scaler_strip_t *strips;
+    scaler_pass_t pass; // The pass the strips are working on.
+
+    uint32_t *padded;       // Source frame.
+    uint32_t *intermediate; // Scale2x result for the second Scale2x pass of Scale4x.
+
+    // Share of each output pixel a corner's xBR edge covers, in 1/256, per factor, corner, row and column.
+    uint16_t coverage[SCALER_FACTOR_MAX + 1][4][SCALER_FACTOR_MAX][SCALER_FACTOR_MAX];
+};
+
+static const struct {
+    const char *name;
+    int factor;
+} filters[SCALER_COUNT] = {
+    [SCALER_SCALE2X] = { "scale2x", 2 },
+    [SCALER_SCALE3X] = { "scale3x", 3 },
+    [SCALER_SCALE4X] = { "scale4x", 4 },
+    [SCALER_XBR2X] = { "xbr2x", 2 },
+    [SCALER_XBR3X] = { "xbr3x", 3 },
+    [SCALER_XBR4X] = { "xbr4x", 4 },
+};
+
+// Corner directions, as signs of x and y.
+static const int corners[4][2] = { { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 } };
+
+// The edge cuts off the part of the pixel beyond the line through the midpoints of the two sides next to the corner.
+// Coverage is sampled 16x16 per output pixel in units of 1/(32 * factor) of the source pixel, samples on the line
+// counting half.
+static void compute_coverage(scaler_t *scaler) {
+    for (int factor = 2; factor <= SCALER_FACTOR_MAX; factor++) {
+        int half = 16 * factor;
+
+        for (int corner = 0; corner < 4; corner++) {
+            for (int row = 0; row < factor; row++) {
+                for (int column = 0; column < factor; column++) {
+                    int count = 0;
+
+                    for (int a = 0; a < 16; a++) {
+                        for (int b = 0; b < 16; b++) {
+                            int u = column * 32 + 2 * b + 1 - half;
+                            int v = row * 32 + 2 * a + 1 - half;
+                            int side = corners[corner][0] * u + corners[corner][1] * v;
+
+                            count += side > half ? 2 : side == half;
+                        }
+                    }
+
+                    scaler->coverage[factor][corner][row][column] = (uint16_t) (count / 2);
+                }
+            }
+        }
+    }
+}
+
+scaler_t *scaler_create(int threads) {
+    scaler_t *scaler = calloc(1, sizeof(scaler_t));
+
+    scaler->pool = threads == 1 ? NULL : pool_create(threads);
+    scaler->strip_count = scaler->pool != NULL ? pool_size(scaler->pool) * SCALER_STRIPS_PER_WORKER : 1;
+    scaler->strips = calloc(scaler->strip_count, sizeof(scaler_strip_t));
+    scaler->padded = malloc(SCALER_PADDED_SIZE(PPU_WIDTH, PPU_HEIGHT) * sizeof(uint32_t));
+    scaler->intermediate = malloc(SCALER_PADDED_SIZE(2 * PPU_WIDTH, 2 * PPU_HEIGHT) * sizeof(uint32_t));
+
+    for (int i = 0; i < scaler->strip_count; i++) {
+        scaler->strips[i].scaler = scaler;
+        scaler->strips[i].index = i;
+    }
+
+    compute_coverage(scaler);
+    return scaler;
+}
+
+void scaler_destroy(scaler_t *scaler) {
+    if (scaler == NULL) return;
+
+    if (scaler->pool != NULL) pool_destroy(scaler->pool);
+    free(scaler->strips);
+    free(scaler->padded);
+    free(scaler->intermediate);
+    free(scaler);
+}
+
+int scaler_factor(scaler_filter_t filter) {
+    return filter >= 0 && filter < SCALER_COUNT ? filters[filter].factor : 0;
+}
+
+const char *scaler_name(scaler_filter_t filter) {
+    return filter >= 0 && filter < SCALER_COUNT ? filters[filter].name : NULL;
+}
+
+static uint32_t *row_at(uint32_t *dst, size_t pitch, int row) {
+    return (uint32_t *) ((uint8_t *) dst + row * pitch);
+}
+
+// Rows are filtered with straight-line compares, selects and blends per pixel, so every clone vectorises across
+// neighbouring pixels.
+SIMD_KERNEL
+static void scale2x_row(const scaler_t *scaler, const uint32_t *src, ptrdiff_t stride, int width, uint32_t *dst,
+                        size_t pitch) {
+    const uint32_t *up = src - stride;
+    const uint32_t *down = src + stride;
+    uint32_t *out0 = dst;
+    uint32_t *out1 = row_at(dst, pitch, 1);
+
+    (void) scaler;
+
+#pragma GCC ivdep // Output rows never overlap the source.
+    for (int x = 0; x < width; x++) {
+        uint32_t b = up[x], d = src[x - 1], e = src[x], f = src[x + 1], h = down[x];
+        // Bitwise like scale3x_row, so the loop stays branch free.
+        int edge = (b != h) & (d != f);
+
+        out0[2 * x] = edge & (d == b) ? d : e;
+        out0[2 * x + 1] = edge & (b == f) ? f : e;
+        out1[2 * x] = edge & (d == h) ? d : e;
+        out1[2 * x + 1] = edge & (h == f) ? f : e;
+    }
+}
+
+SIMD_KERNEL
+static void scale3x_row(const scaler_t *scaler, const uint32_t *src, ptrdiff_t stride, int width, uint32_t *dst,
+                        size_t pitch) {
+    const uint32_t *up = src - stride;
+    const uint32_t *down = src + stride;
+    uint32_t *out0 = dst;
+    uint32_t *out1 = row_at(dst, pitch, 1);
+    uint32_t *out2 = row_at(dst, pitch, 2);
+
+    (void) scaler;
+
+#pragma GCC ivdep // Output rows never overlap the source.
+    for (int x = 0; x < width; x++) {
+        uint32_t a = up[x - 1], b = up[x], c = up[x + 1];
+        uint32_t d = src[x - 1], e = src[x], f = src[x + 1];
+        uint32_t g = down[x - 1], h = down[x], i = down[x + 1];
+        // Bitwise instead of short-circuit operators, which would be branches.
+        int edge = (b != h) & (d != f);
+        int db = edge & (d == b), bf = edge & (b == f), dh = edge & (d == h), hf = edge & (h == f);
+
+        out0[3 * x] = db ? d : e;
+        out0[3 * x + 1] = (db & (e != c)) | (bf & (e != a)) ? b : e;
+        out0[3 * x + 2] = bf ? f : e;
+        out1[3 * x] = (db & (e != g)) | (dh & (e != a)) ? d : e;
+        out1[3 * x + 1] = e;
+        out1[3 * x + 2] = (bf & (e != i)) | (hf & (e != c)) ? f : e;
+        out2[3 * x] = dh ? d : e;
+        out2[3 * x + 1] = (dh & (e != i)) | (hf & (e != g)) ? h : e;
+        out2[3 * x + 2] = hf ? f : e;
+    }
+}
+
+// Colour distance weighing green double, and the other two channels the same so RGBA and BGRA agree.
+static inline __attribute__((always_inline)) uint32_t distance(uint32_t a, uint32_t b) {
+    int d0 = (int) (a & 0xff) - (int) (b & 0xff);
+    int d1 = (int) (a >> 8 & 0xff) - (int) (b >> 8 & 0xff);
+    int d2 = (int) (a >> 16 & 0xff) - (int) (b >> 16 & 0xff);
+
+    return (uint32_t) ((d0 < 0 ? -d0 : d0) + 2 * (d1 < 0 ? -d1 : d1) + (d2 < 0 ? -d2 : d2));
+}
+
+// weight / 256 of b over a, two channels per multiply. weight 0 returns a unchanged.
+static inline __attribute__((always_inline)) uint32_t blend(uint32_t a, uint32_t b, uint32_t weight) {
+    uint32_t rb = ((a & 0x00ff00ff) * (256 - weight) + (b & 0x00ff00ff) * weight) >> 8 & 0x00ff00ff;
+    uint32_t ga = ((a >> 8 & 0x00ff00ff) * (256 - weight) + (b >> 8 & 0x00ff00ff) * weight) & 0xff00ff00;
+
+    return rb | ga;
+}
+
+// Hyllian's xBR level 1 edge rule for the corner in direction dx, dy: the corner is an edge if the colour differences
+// across the anti-diagonal outweigh those along it. Returns the colour to blend in, or the centre pixel if there's no
+// edge.
+static inline __attribute__((always_inline)) uint32_t xbr_corner(const uint32_t *p, ptrdiff_t dx, ptrdiff_t dy) {
+#define P(x, y) p[(x) * dx + (y) * dy]
+    uint32_t e = P(0, 0), b = P(0, -1), d = P(-1, 0), f = P(1, 0), h = P(0, 1);
+    uint32_t c = P(1, -1), g = P(-1, 1), i = P(1, 1);
+    uint32_t f4 = P(2, 0), h5 = P(0, 2), i4 = P(2, 1), i5 = P(1, 2);
+#undef P
+
+    uint32_t along = distance(e, c) + distance(e, g) + distance(i, f4) + distance(i, h5) + 4 * distance(h, f);
+    uint32_t across = distance(h, d) + distance(h, i5) + distance(f, i4) + distance(f, b) + 4 * distance(e, i);
+    uint32_t color = distance(e, f) <= distance(e, h) ? f : h;
+
+    return along < across ? color : e;
+}
+
+static inline __attribute__((always_inline)) void xbr_row(const scaler_t *scaler, const uint32_t *src,
+                                                          ptrdiff_t stride, int width, uint32_t *dst, size_t pitch,
+                                                          const int factor) {
+    const uint16_t (*coverage)[SCALER_FACTOR_MAX][SCALER_FACTOR_MAX] = scaler->coverage[factor];
+    uint32_t *out[SCALER_FACTOR_MAX];
+
+    for (int row = 0; row < factor; row++) out[row] = row_at(dst, pitch, row);
+
+#pragma GCC ivdep // Output rows never overlap the source.
+    for (int x = 0; x < width; x++) {
+        const uint32_t *p = src + x;
+        uint32_t colors[4];
+
+#pragma GCC unroll 4
+        for (int corner = 0; corner < 4; corner++) {
+            colors[corner] = xbr_corner(p, corners[corner][0], corners[corner][1] * stride);
+        }
+
+        // Blending the centre pixel with itself changes nothing, so corners without an edge need no branch.
+#pragma GCC unroll 4
+        for (int row = 0; row < factor; row++) {
+#pragma GCC unroll 4
+            for (int column = 0; column < factor; column++) {
+                uint32_t color = p[0];
+
+#pragma GCC unroll 4
+                for (int corner = 0; corner < 4; corner++) {
+                    color = blend(color, colors[corner], coverage[corner][row][column]);
+                }
+
+                out[row][x * factor + column] = color;
+            }
+        }
+    }
+}
+
+#define SCALER_XBR(factor) \
+    SIMD_KERNEL \
+    static void xbr##factor##x_row(const scaler_t *scaler, const uint32_t *src, ptrdiff_t stride, int width, \
+                                   uint32_t *dst, size_t pitch) { \
+        xbr_row(scaler, src, stride, width, dst, pitch, factor); \
+    }
+
+SCALER_XBR(2)
+SCALER_XBR(3)
+SCALER_XBR(4)
+
+// Fills the border around width * height pixels at interior from the pixels along the edges.
+static void pad(uint32_t *interior, ptrdiff_t stride, int width, int height) {
+    for (int y = 0; y < height; y++) {
+        uint32_t *row = interior + y * stride;
+
+        for (int i = 1; i <= SCALER_BORDER; i++) {
+            row[-i] = row[0];
+            row[width - 1 + i] = row[width - 1];
+        }
+    }
+
+    for (int i = 1; i <= SCALER_BORDER; i++) {
+        memcpy(interior - i * stride - SCALER_BORDER, interior - SCALER_BORDER, stride * sizeof(uint32_t));
+        memcpy(interior + (height - 1 + i) * stride - SCALER_BORDER, interior + (height - 1) * stride - SCALER_BORDER,
+               stride * sizeof(uint32_t));
+    }
+}
+
+static void run_strip(void *arg, int worker) {
+    const scaler_strip_t *strip = arg;
+    const scaler_t *scaler = strip->scaler;
+    const scaler_pass_t *pass = &scaler->pass;
+    int begin = pass->height * strip->index / scaler->strip_count;
+    int end = pass->height * (strip->index + 1) / scaler->strip_count;
+
+    (void) worker;
+
+    for (int y = begin; y < end; y++) {
+        pass->row(scaler, pass->src + y * pass->stride, pass->stride, pass->width,
+                  row_at(pass->dst, pass->pitch, y * pass->factor), pass->pitch);
+    }
+}
+
+static void run_pass(scaler_t *scaler, scaler_row_fn row, const uint32_t *src, int width, int height, int factor,
+                     uint32_t *dst, size_t pitch) {
+    scaler_pass_t pass = { row, src, SCALER_STRIDE(width), width, height, factor, dst, pitch };
+    scaler->pass = pass;
+
+    if (scaler->pool == NULL) {
+        run_strip(&scaler->strips[0], 0);
+        return;
+    }
+
+    for (int i = 0; i < scaler->strip_count; i++) pool_submit(scaler->pool, run_strip, &scaler->strips[i]);
+    pool_wait(scaler->pool);
+}
+
+int scaler_run(scaler_t *scaler, scaler_filter_t filter, const uint32_t *src, size_t src_pitch, uint32_t *dst,
+               size_t dst_pitch) {
+    if (scaler_factor(filter) == 0) return -1;
+
+    uint64_t begin = timeline_begin();
+    ptrdiff_t stride = SCALER_STRIDE(PPU_WIDTH);
+    uint32_t *frame = scaler->padded + SCALER_BORDER * stride + SCALER_BORDER;
+
+    for (int y = 0; y < PPU_HEIGHT; y++) {
+        memcpy(frame + y * stride, row_at((uint32_t *) src, src_pitch, y), PPU_WIDTH * sizeof(uint32_t));
+    }
+
+    pad(frame, stride, PPU_WIDTH, PPU_HEIGHT);
+
+    switch (filter) {
+        case SCALER_SCALE2X: run_pass(scaler, scale2x_row, frame, PPU_WIDTH, PPU_HEIGHT, 2, dst, dst_pitch); break;
+        case SCALER_SCALE3X: run_pass(scaler, scale3x_row, frame, PPU_WIDTH, PPU_HEIGHT, 3, dst, dst_pitch); break;
+
+        case SCALER_SCALE4X: {
+            ptrdiff_t doubled_stride = SCALER_STRIDE(2 * PPU_WIDTH);
+            uint32_t *doubled = scaler->intermediate + SCALER_BORDER * doubled_stride + SCALER_BORDER;
+
+            run_pass(scaler, scale2x_row, frame, PPU_WIDTH, PPU_HEIGHT, 2, doubled,
+                     doubled_stride * sizeof(uint32_t));
+            pad(doubled, doubled_stride, 2 * PPU_WIDTH, 2 * PPU_HEIGHT);
+            run_pass(scaler, scale2x_row, doubled, 2 * PPU_WIDTH, 2 * PPU_HEIGHT, 2, dst, dst_pitch);
+            break;
+        }
+
+        case SCALER_XBR2X: run_pass(scaler, xbr2x_row, frame, PPU_WIDTH, PPU_HEIGHT, 2, dst, dst_pitch); break;
+        case SCALER_XBR3X: run_pass(scaler, xbr3x_row, frame, PPU_WIDTH, PPU_HEIGHT, 3, dst, dst_pitch); break;
+        default: run_pass(scaler, xbr4x_row, frame, PPU_WIDTH, PPU_HEIGHT, 4, dst, dst_pitch); break;
+    }
+
+    timeline_end("scaler", begin);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef CGAMEBOY_SCALER_H
+#define CGAMEBOY_SCALER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    SCALER_SCALE2X,
+    SCALER_SCALE3X,
+    SCALER_SCALE4X, // Scale2x twice.
+    SCALER_XBR2X,
+    SCALER_XBR3X,
+    SCALER_XBR4X,
+    SCALER_COUNT,
+} scaler_filter_t;
+
+typedef struct scaler scaler_t;
+
+// Pixel art filters for a finished PPU_WIDTH * PPU_HEIGHT frame of 32 bit pixels, e.g. from video_convert() at scale 1.
+// Scale2x/3x only compare pixels, so they work on any 32 bit format. xBR blends colours, which works for RGBA and BGRA
+// alike since it weighs the first and third channel the same.
+//
+// A frame is split into horizontal strips that the pool's workers filter in parallel. threads 0 means one per core,
+// 1 runs everything on the calling thread.
+scaler_t *scaler_create(int threads);
+void scaler_destroy(scaler_t *scaler);
+
+int scaler_factor(scaler_filter_t filter);
+const char *scaler_name(scaler_filter_t filter);
+
+// Filters src (rows src_pitch bytes apart) into dst, which takes scaler_factor() times the frame in each direction.
+// Returns -1 for an unknown filter.
+int scaler_run(scaler_t *scaler, scaler_filter_t filter, const uint32_t *src, size_t src_pitch, uint32_t *dst,
+               size_t dst_pitch);
+
+#endif //CGAMEBOY_SCALER_H
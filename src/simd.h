@@ -0,0 +1,12 @@
+#ifndef CGAMEBOY_SIMD_H
+#define CGAMEBOY_SIMD_H
+
+// Compiles a function once per ISA level and picks the clone at load time, for the lockstep, video and scaler
+// kernels. Those are written as straight-line loops the compiler vectorises, so each clone gets its own vector width.
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__)
+#define SIMD_KERNEL __attribute__((target_clones("arch=x86-64-v4", "avx2", "default")))
+#else
+#define SIMD_KERNEL
+#endif
+
+#endif //CGAMEBOY_SIMD_H
@@ -0,0 +1,148 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "stats.h"
+
+#define STATS_FIRST_OCTAVE 10 // 1024 ns
+
+struct stats {
+    char *name;
+    stats_shared_t *shared;
+
+    // The writer's own copy, so publishing never has to read the shared segment back.
+    uint64_t histogram[STATS_HISTOGRAM_BUCKETS];
+    uint64_t frames;
+    uint64_t frame_ns_total;
+    uint64_t start_instructions;
+};
+
+static void store(_Atomic uint64_t *field, uint64_t value) {
+    atomic_store_explicit(field, value, memory_order_relaxed);
+}
+
+static int bucket_of(uint64_t ns) {
+    if (ns < 1u << STATS_FIRST_OCTAVE) return 0;
+
+    int octave = 63 - __builtin_clzll(ns);
+    int bucket = (octave - STATS_FIRST_OCTAVE) * 4 + (int) (ns >> (octave - 2) & 3);
+
+    return bucket < STATS_HISTOGRAM_BUCKETS ? bucket : STATS_HISTOGRAM_BUCKETS - 1;
+}
+
+static uint64_t bucket_upper_edge(int bucket) {
+    int octave = STATS_FIRST_OCTAVE + bucket / 4;
+    return ((uint64_t) 4 + bucket % 4 + 1) << (octave - 2);
+}
+
+stats_t *stats_open(const char *name, const gameboy_t *gb) {
+    shm_unlink(name);
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) return NULL;
+
+    if (ftruncate(fd, sizeof(stats_shared_t)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    stats_shared_t *shared = mmap(NULL, sizeof(stats_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (shared == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    stats_t *stats = calloc(1, sizeof(stats_t));
+    stats->name = strdup(name);
+    stats->shared = shared;
+    stats->start_instructions = gb->instructions;
+
+    // The segment starts zeroed, so the header going in last is what tells readers it's ready.
+    shared->size = sizeof(stats_shared_t);
+    shared->pid = (uint32_t) getpid();
+    shared->version = STATS_VERSION;
+    atomic_store_explicit(&shared->magic, STATS_MAGIC, memory_order_release);
+
+    return stats;
+}
+
+void stats_close(stats_t *stats) {
+    if (stats == NULL) return;
+
+    munmap(stats->shared, sizeof(stats_shared_t));
+    shm_unlink(stats->name);
+
+    free(stats->name);
+    free(stats);
+}
+
+void stats_frame(stats_t *stats, const gameboy_t *gb, uint64_t frame_ns) {
+    stats_shared_t *shared = stats->shared;
+    int bucket = bucket_of(frame_ns);
+
+    stats->histogram[bucket]++;
+    stats->frames++;
+    stats->frame_ns_total += frame_ns;
+
+    uint64_t threshold = stats->frames - stats->frames / 100;
+    uint64_t seen = 0;
+    int p99 = 0;
+
+    while (p99 < STATS_HISTOGRAM_BUCKETS - 1 && (seen += stats->histogram[p99]) < threshold) p99++;
+
+    store(&shared->cycles, gb->cycles);
+    store(&shared->frames, gb->frames);
+    store(&shared->instructions, gb->instructions);
+    store(&shared->frame_ns_mean, stats->frame_ns_total / stats->frames);
+    store(&shared->frame_ns_p99, bucket_upper_edge(p99));
+    store(&shared->frame_ns_histogram[bucket], stats->histogram[bucket]);
+
+    if (stats->frame_ns_total > 0) {
+        double instructions = (double) (gb->instructions - stats->start_instructions);
+        store(&shared->instructions_per_second, (uint64_t) (instructions * 1e9 / (double) stats->frame_ns_total));
+    }
+
+    store(&shared->updates, atomic_load_explicit(&shared->updates, memory_order_relaxed) + 1);
+}
+
+static uint64_t load(const _Atomic uint64_t *field) {
+    return atomic_load_explicit(field, memory_order_relaxed);
+}
+
+int stats_dump(const char *name, FILE *out) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return -1;
+
+    const stats_shared_t *shared = mmap(NULL, sizeof(stats_shared_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (shared == MAP_FAILED) return -1;
+
+    if (atomic_load_explicit(&shared->magic, memory_order_acquire) != STATS_MAGIC
+        || shared->version != STATS_VERSION) {
+        munmap((void *) shared, sizeof(stats_shared_t));
+        return -1;
+    }
+
+    uint64_t lookups = load(&shared->block_cache_lookups);
+
+    fprintf(out, "pid %u\n", shared->pid);
+    fprintf(out, "updates %llu\n", (unsigned long long) load(&shared->updates));
+    fprintf(out, "cycles %llu\n", (unsigned long long) load(&shared->cycles));
+    fprintf(out, "frames %llu\n", (unsigned long long) load(&shared->frames));
+    fprintf(out, "instructions %llu\n", (unsigned long long) load(&shared->instructions));
+    fprintf(out, "frame_ns_mean %llu\n", (unsigned long long) load(&shared->frame_ns_mean));
+    fprintf(out, "frame_ns_p99 %llu\n", (unsigned long long) load(&shared->frame_ns_p99));
+    fprintf(out, "instructions_per_second %llu\n", (unsigned long long) load(&shared->instructions_per_second));
+    fprintf(out, "block_cache_hit_rate %.4f\n",
+            lookups ? (double) load(&shared->block_cache_hits) / (double) lookups : 0.0);
+    fprintf(out, "audio_underruns %llu\n", (unsigned long long) load(&shared->audio_underruns));
+
+    munmap((void *) shared, sizeof(stats_shared_t));
+    return 0;
+}
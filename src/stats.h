@@ -0,0 +1,61 @@
+#ifndef CGAMEBOY_STATS_H
+#define CGAMEBOY_STATS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gameboy.h"
+
+#define STATS_MAGIC 0x53424743u // "CGBS"
+#define STATS_VERSION 1
+#define STATS_HISTOGRAM_BUCKETS 64
+#define STATS_RESERVED 16
+
+// Live counters of one instance in a shared memory segment, for a sidecar to scrape. The emulation thread only ever
+// does relaxed atomic stores, so readers never block it; in return they only get each field consistent on its own.
+// A reader checks magic and version and ignores anything past size it doesn't know about. Later versions take their
+// fields out of reserved, so existing offsets never move.
+//
+// Frame times are kept in a log2 histogram with 4 buckets per octave starting at 1 us, p99 is the upper edge of the
+// bucket holding it. Block cache and audio counters stay 0 until there is a block cache and audio.
+typedef struct {
+    _Atomic uint32_t magic; // Stored last, with release order.
+    uint32_t version;
+    uint32_t size;
+    uint32_t pid;
+
+    _Atomic uint64_t updates; // Bumped after every frame's stores.
+    _Atomic uint64_t cycles;
+    _Atomic uint64_t frames;
+    _Atomic uint64_t instructions;
+
+    _Atomic uint64_t frame_ns_mean;
+    _Atomic uint64_t frame_ns_p99;
+    _Atomic uint64_t instructions_per_second;
+
+    _Atomic uint64_t block_cache_hits;
+    _Atomic uint64_t block_cache_lookups;
+    _Atomic uint64_t audio_underruns;
+
+    _Atomic uint64_t reserved[STATS_RESERVED];
+    _Atomic uint64_t frame_ns_histogram[STATS_HISTOGRAM_BUCKETS];
+} stats_shared_t;
+
+typedef struct stats stats_t;
+
+// Creates the POSIX shared memory object name for gb, replacing an old one. Rates count from here on. Returns NULL if
+// it can't be mapped.
+stats_t *stats_open(const char *name, const gameboy_t *gb);
+
+// Unmaps and unlinks the segment.
+void stats_close(stats_t *stats);
+
+// Publishes the counters of gb after a frame that took frame_ns of host time.
+void stats_frame(stats_t *stats, const gameboy_t *gb, uint64_t frame_ns);
+
+// Sidecar side: maps the segment name read-only and prints it as "<field> <value>" lines. Returns -1 if it doesn't
+// exist or isn't a stats segment of a known version.
+int stats_dump(const char *name, FILE *out);
+
+#endif //CGAMEBOY_STATS_H
@@ -0,0 +1,378 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "symprof.h"
+
+#define SYMPROF_MAX_DEPTH 1024
+
+typedef struct {
+    int parent;
+    long function;
+    uint64_t cycles;
+} node_t;
+
+typedef struct {
+    int node;
+    long function;
+    uint16_t return_address;
+    uint64_t entry;
+} frame_t;
+
+struct symprof {
+    gameboy_t *gb;
+    const symbols_t *symbols;
+    cpu_probes_t probes;
+
+    // Indexed by symbol, the last entry collects calls into unknown code.
+    uint64_t *inclusive;
+    uint64_t *exclusive;
+    uint64_t *calls;
+
+    // Call stack trie, node 0 is the code running before any call.
+    node_t *nodes;
+    size_t node_count;
+    size_t node_capacity;
+
+    // Maps (parent, function) to the child node + 1, 0 being empty.
+    uint64_t *child_keys;
+    int *child_nodes;
+    size_t child_mask;
+
+    frame_t stack[SYMPROF_MAX_DEPTH];
+    int depth;
+    uint64_t overflow;
+    uint64_t last;
+};
+
+static int by_address(const void *a, const void *b) {
+    const symbol_t *x = a;
+    const symbol_t *y = b;
+
+    if (x->bank != y->bank) return x->bank < y->bank ? -1 : 1;
+    return x->address < y->address ? -1 : x->address > y->address;
+}
+
+int symbols_load(symbols_t *symbols, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return -1;
+
+    size_t capacity = 0;
+    char line[512];
+
+    symbols->symbols = NULL;
+    symbols->count = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *comment = strchr(line, ';');
+        if (comment != NULL) *comment = '\0';
+
+        unsigned bank;
+        unsigned address;
+        char name[256];
+
+        int fields = sscanf(line, "%x:%x %255s", &bank, &address, name);
+        if (fields <= 0) continue;
+
+        if (fields != 3 || bank > 0xff || address > 0xffff) {
+            symbols_free(symbols);
+            fclose(file);
+            return -1;
+        }
+
+        if (symbols->count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            symbols->symbols = realloc(symbols->symbols, capacity * sizeof(symbol_t));
+        }
+
+        symbol_t *symbol = &symbols->symbols[symbols->count++];
+        symbol->bank = (uint8_t) bank;
+        symbol->address = (uint16_t) address;
+        symbol->name = strdup(name);
+    }
+
+    fclose(file);
+    qsort(symbols->symbols, symbols->count, sizeof(symbol_t), by_address);
+    return 0;
+}
+
+void symbols_free(symbols_t *symbols) {
+    for (size_t i = 0; i < symbols->count; i++) {
+        free(symbols->symbols[i].name);
+    }
+
+    free(symbols->symbols);
+    symbols->symbols = NULL;
+    symbols->count = 0;
+}
+
+// Without an MBC the switchable ROM area is always bank 1. RAM symbols are listed as bank 0.
+static int region(uint16_t address) {
+    return address < 0x4000 ? 0 : address < 0x8000 ? 1 : 2;
+}
+
+long symbols_find(const symbols_t *symbols, uint16_t address) {
+    uint8_t bank = region(address) == 1 ? 1 : 0;
+    size_t low = 0;
+    size_t high = symbols->count;
+
+    // First symbol after (bank, address).
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        const symbol_t *symbol = &symbols->symbols[middle];
+
+        if (symbol->bank < bank || (symbol->bank == bank && symbol->address <= address)) low = middle + 1;
+        else high = middle;
+    }
+
+    if (low == 0) return -1;
+
+    const symbol_t *symbol = &symbols->symbols[low - 1];
+    if (symbol->bank != bank || region(symbol->address) != region(address)) return -1;
+
+    return (long) low - 1;
+}
+
+static long function_of(const symprof_t *profiler, uint16_t address) {
+    long index = symbols_find(profiler->symbols, address);
+    return index < 0 ? (long) profiler->symbols->count : index;
+}
+
+static const char *function_name(const symprof_t *profiler, long function) {
+    return function < (long) profiler->symbols->count ? profiler->symbols->symbols[function].name : "[unknown]";
+}
+
+static int add_node(symprof_t *profiler, int parent, long function) {
+    if (profiler->node_count == profiler->node_capacity) {
+        profiler->node_capacity = profiler->node_capacity ? profiler->node_capacity * 2 : 256;
+        profiler->nodes = realloc(profiler->nodes, profiler->node_capacity * sizeof(node_t));
+    }
+
+    node_t *node = &profiler->nodes[profiler->node_count];
+    node->parent = parent;
+    node->function = function;
+    node->cycles = 0;
+
+    return (int) profiler->node_count++;
+}
+
+static void grow_children(symprof_t *profiler);
+
+static int child_node(symprof_t *profiler, int parent, long function) {
+    uint64_t key = (uint64_t) parent << 32 | (uint32_t) function;
+    size_t i = (size_t) ((key * 0x9e3779b97f4a7c15ULL) >> 32) & profiler->child_mask;
+
+    for (;; i = (i + 1) & profiler->child_mask) {
+        if (profiler->child_nodes[i] == 0) break;
+        if (profiler->child_keys[i] == key) return profiler->child_nodes[i] - 1;
+    }
+
+    int node = add_node(profiler, parent, function);
+    profiler->child_keys[i] = key;
+    profiler->child_nodes[i] = node + 1;
+
+    if (profiler->node_count * 2 > profiler->child_mask) grow_children(profiler);
+    return node;
+}
+
+static void grow_children(symprof_t *profiler) {
+    size_t size = (profiler->child_mask + 1) * 2;
+
+    free(profiler->child_keys);
+    free(profiler->child_nodes);
+    profiler->child_keys = calloc(size, sizeof(uint64_t));
+    profiler->child_nodes = calloc(size, sizeof(int));
+    profiler->child_mask = size - 1;
+
+    for (size_t node = 1; node < profiler->node_count; node++) {
+        uint64_t key = (uint64_t) profiler->nodes[node].parent << 32 | (uint32_t) profiler->nodes[node].function;
+        size_t i = (size_t) ((key * 0x9e3779b97f4a7c15ULL) >> 32) & profiler->child_mask;
+
+        while (profiler->child_nodes[i] != 0) i = (i + 1) & profiler->child_mask;
+
+        profiler->child_keys[i] = key;
+        profiler->child_nodes[i] = (int) node + 1;
+    }
+}
+
+// Hands the cycles since the last call or return to the function on top of the stack.
+static void attribute(symprof_t *profiler) {
+    frame_t *top = &profiler->stack[profiler->depth - 1];
+    uint64_t cycles = profiler->gb->cycles - profiler->last;
+
+    profiler->exclusive[top->function] += cycles;
+    profiler->nodes[top->node].cycles += cycles;
+    profiler->last = profiler->gb->cycles;
+}
+
+static int on_stack(const symprof_t *profiler, int depth, long function) {
+    for (int i = 0; i < depth; i++) {
+        if (profiler->stack[i].function == function) return 1;
+    }
+
+    return 0;
+}
+
+static void pop(symprof_t *profiler) {
+    frame_t *frame = &profiler->stack[--profiler->depth];
+
+    // Recursive calls are already covered by the outermost frame of the same function.
+    if (!on_stack(profiler, profiler->depth, frame->function)) {
+        profiler->inclusive[frame->function] += profiler->gb->cycles - frame->entry;
+    }
+}
+
+static void on_call(void *ctx, uint16_t target, uint16_t return_address) {
+    symprof_t *profiler = ctx;
+    attribute(profiler);
+
+    long function = function_of(profiler, target);
+    profiler->calls[function]++;
+
+    if (profiler->depth == SYMPROF_MAX_DEPTH) {
+        profiler->overflow++;
+        return;
+    }
+
+    frame_t *frame = &profiler->stack[profiler->depth];
+    frame->node = child_node(profiler, profiler->stack[profiler->depth - 1].node, function);
+    frame->function = function;
+    frame->return_address = return_address;
+    frame->entry = profiler->gb->cycles;
+    profiler->depth++;
+}
+
+// Unwinds to the frame that returns to target, so code that drops stack frames by hand doesn't desync the stack.
+static void on_return(void *ctx, uint16_t target) {
+    symprof_t *profiler = ctx;
+    attribute(profiler);
+
+    if (profiler->overflow > 0) {
+        profiler->overflow--;
+        return;
+    }
+
+    int match = profiler->depth - 1;
+    while (match > 0 && profiler->stack[match].return_address != target) match--;
+
+    if (match == 0) match = profiler->depth - 1;
+    while (profiler->depth > match && profiler->depth > 1) pop(profiler);
+}
+
+symprof_t *symprof_attach(gameboy_t *gb, const symbols_t *symbols) {
+    symprof_t *profiler = calloc(1, sizeof(symprof_t));
+    size_t functions = symbols->count + 1;
+
+    profiler->gb = gb;
+    profiler->symbols = symbols;
+    profiler->inclusive = calloc(functions, sizeof(uint64_t));
+    profiler->exclusive = calloc(functions, sizeof(uint64_t));
+    profiler->calls = calloc(functions, sizeof(uint64_t));
+
+    profiler->child_mask = 255;
+    profiler->child_keys = calloc(profiler->child_mask + 1, sizeof(uint64_t));
+    profiler->child_nodes = calloc(profiler->child_mask + 1, sizeof(int));
+
+    long function = function_of(profiler, gb->cpu.registers.dw.PC);
+    profiler->stack[0].node = add_node(profiler, -1, function);
+    profiler->stack[0].function = function;
+    profiler->stack[0].entry = gb->cycles;
+    profiler->depth = 1;
+    profiler->last = gb->cycles;
+
+    profiler->probes.on_call = on_call;
+    profiler->probes.on_return = on_return;
+    profiler->probes.hook_ctx = profiler;
+    gameboy_set_probes(gb, &profiler->probes);
+
+    return profiler;
+}
+
+void symprof_detach(symprof_t *profiler) {
+    if (profiler == NULL) return;
+    if (profiler->gb->probes == &profiler->probes) gameboy_set_probes(profiler->gb, NULL);
+
+    free(profiler->inclusive);
+    free(profiler->exclusive);
+    free(profiler->calls);
+    free(profiler->nodes);
+    free(profiler->child_keys);
+    free(profiler->child_nodes);
+    free(profiler);
+}
+
+typedef struct {
+    long function;
+    uint64_t inclusive;
+} row_t;
+
+static int by_inclusive(const void *a, const void *b) {
+    const row_t *x = a;
+    const row_t *y = b;
+
+    if (x->inclusive != y->inclusive) return x->inclusive < y->inclusive ? 1 : -1;
+    return x->function < y->function ? -1 : x->function > y->function;
+}
+
+void symprof_report(symprof_t *profiler, FILE *out) {
+    size_t functions = profiler->symbols->count + 1;
+    row_t *rows = malloc(functions * sizeof(row_t));
+    size_t used = 0;
+
+    attribute(profiler);
+
+    for (size_t i = 0; i < functions; i++) {
+        uint64_t inclusive = profiler->inclusive[i];
+
+        // Frames that are still open count up to now.
+        for (int depth = 0; depth < profiler->depth; depth++) {
+            if (profiler->stack[depth].function == (long) i) {
+                inclusive += profiler->gb->cycles - profiler->stack[depth].entry;
+                break;
+            }
+        }
+
+        if (inclusive == 0 && profiler->exclusive[i] == 0 && profiler->calls[i] == 0) continue;
+
+        rows[used].function = (long) i;
+        rows[used].inclusive = inclusive;
+        used++;
+    }
+
+    qsort(rows, used, sizeof(row_t), by_inclusive);
+
+    uint64_t total = profiler->gb->cycles - profiler->stack[0].entry;
+    fprintf(out, "%14s %7s %14s %7s %10s  %s\n", "inclusive", "%", "exclusive", "%", "calls", "function");
+
+    for (size_t i = 0; i < used; i++) {
+        long function = rows[i].function;
+
+        fprintf(out, "%14" PRIu64 " %6.2f%% %14" PRIu64 " %6.2f%% %10" PRIu64 "  %s\n", rows[i].inclusive,
+                total ? 100.0 * (double) rows[i].inclusive / (double) total : 0.0, profiler->exclusive[function],
+                total ? 100.0 * (double) profiler->exclusive[function] / (double) total : 0.0,
+                profiler->calls[function], function_name(profiler, function));
+    }
+
+    free(rows);
+}
+
+void symprof_write_folded(symprof_t *profiler, FILE *out) {
+    long path[SYMPROF_MAX_DEPTH + 1];
+
+    attribute(profiler);
+
+    for (size_t i = 0; i < profiler->node_count; i++) {
+        if (profiler->nodes[i].cycles == 0) continue;
+
+        int length = 0;
+        for (int node = (int) i; node >= 0 && length <= SYMPROF_MAX_DEPTH; node = profiler->nodes[node].parent) {
+            path[length++] = profiler->nodes[node].function;
+        }
+
+        for (int j = length - 1; j >= 0; j--) {
+            fprintf(out, "%s%c", function_name(profiler, path[j]), j > 0 ? ';' : ' ');
+        }
+
+        fprintf(out, "%" PRIu64 "\n", profiler->nodes[i].cycles);
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef CGAMEBOY_SYMPROF_H
+#define CGAMEBOY_SYMPROF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gameboy.h"
+
+typedef struct {
+    uint8_t bank;
+    uint16_t address;
+    char *name;
+} symbol_t;
+
+// RGBDS / no$gmb symbol file, "BB:AAAA Name" per line, ';' starts a comment. Sorted by bank and address.
+typedef struct {
+    symbol_t *symbols;
+    size_t count;
+} symbols_t;
+
+int symbols_load(symbols_t *symbols, const char *path);
+void symbols_free(symbols_t *symbols);
+
+// Index of the symbol an address belongs to, that is the closest one at or below it in the same bank, or -1.
+long symbols_find(const symbols_t *symbols, uint16_t address);
+
+typedef struct symprof symprof_t;
+
+// Guest function profiler. A shadow call stack follows CALL/RST and RET/RETI through the CPU hooks, and every cycle
+// between two of those events goes to the function on top of it. Attaching replaces gb->probes.
+symprof_t *symprof_attach(gameboy_t *gb, const symbols_t *symbols);
+void symprof_detach(symprof_t *profiler);
+
+// Per function inclusive and exclusive cycles and call counts, sorted by inclusive cycles.
+void symprof_report(symprof_t *profiler, FILE *out);
+// One "outer;inner;leaf cycles" line per distinct call stack, the input format of flamegraph.pl.
+void symprof_write_folded(symprof_t *profiler, FILE *out);
+
+#endif //CGAMEBOY_SYMPROF_H
@@ -0,0 +1,607 @@
+#include <ctype.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "lockstep.h"
+#include "pool.h"
+#include "testvec.h"
+
+#define TESTVEC_MAX_RAM 32
+
+typedef enum { REG_PC, REG_SP, REG_A, REG_B, REG_C, REG_D, REG_E, REG_F, REG_H, REG_L, REG_IME, REG_IE, REG_COUNT } reg_t;
+
+static const char *const reg_names[REG_COUNT] = { "pc", "sp", "a", "b", "c", "d", "e", "f", "h", "l", "ime", "ie" };
+
+typedef struct {
+    uint16_t address;
+    uint8_t value;
+} testvec_byte_t;
+
+typedef struct {
+    uint16_t reg[REG_COUNT];
+    unsigned present; // Bit per reg_t.
+
+    int ram_count;
+    testvec_byte_t ram[TESTVEC_MAX_RAM];
+} testvec_state_t;
+
+typedef struct {
+    char name[32];
+    testvec_state_t initial;
+    testvec_state_t final;
+    int bus_cycles; // M-cycles.
+} testvec_t;
+
+typedef struct testvec_run testvec_run_t;
+
+typedef struct {
+    testvec_run_t *run;
+    char name[256];
+
+    int failed;
+    long vectors;
+    long passed;
+    long timing_mismatches;
+    long backend_mismatches;
+    long mismatches_by_backend[BACKEND_COUNT];
+
+    char failure[256];  // First vector not matching the final state, for verbose output.
+    char mismatch[256]; // First vector a backend disagreed on.
+} file_job_t;
+
+// Per-thread machines. All memory is zero between vectors, only the pages a vector dirtied are wiped again.
+typedef struct {
+    gameboy_t *scalar[BACKEND_LANES];
+    gameboy_t *lanes[CPU_LANES_MAX];
+    lockstep_t lockstep;
+
+    cpu_probes_t probes;
+    uint8_t coverage[CPU_COVERAGE_SIZE];
+} worker_t;
+
+struct testvec_run {
+    const char *dir;
+    file_job_t *jobs;
+    size_t job_count;
+    worker_t **workers;
+};
+
+typedef struct {
+    const char *p;
+    const char *end;
+} json_t;
+
+static int json_peek(json_t *json) {
+    while (json->p < json->end && isspace((unsigned char) *json->p)) json->p++;
+
+    return json->p < json->end ? *json->p : -1;
+}
+
+static int json_expect(json_t *json, char c) {
+    if (json_peek(json) != c) return -1;
+
+    json->p++;
+    return 0;
+}
+
+// Escapes are taken literally, names and keys in test vectors don't have any.
+static int json_string(json_t *json, char *out, size_t size) {
+    size_t length = 0;
+    if (json_expect(json, '"') != 0) return -1;
+
+    while (json->p < json->end && *json->p != '"') {
+        if (*json->p == '\\' && json->p + 1 < json->end) json->p++;
+
+        char c = *json->p++;
+        if (out != NULL && length + 1 < size) out[length++] = c;
+    }
+
+    if (json->p >= json->end) return -1;
+    if (out != NULL) out[length] = '\0';
+
+    json->p++;
+    return 0;
+}
+
+// The buffer is NUL terminated, so strtol can't run off its end.
+static int json_number(json_t *json, long *value) {
+    if (json_peek(json) < 0) return -1;
+
+    char *end;
+    *value = strtol(json->p, &end, 10);
+    if (end == json->p) return -1;
+
+    json->p = end;
+    return 0;
+}
+
+// Steps through the elements of an array or object whose opening bracket was consumed: 1 if another one follows,
+// 0 after the closing bracket, -1 on a syntax error.
+static int json_next(json_t *json, char close, int *count) {
+    int c = json_peek(json);
+
+    if (c == close) {
+        json->p++;
+        return 0;
+    }
+
+    if (*count > 0) {
+        if (c != ',') return -1;
+        json->p++;
+    }
+
+    (*count)++;
+    return 1;
+}
+
+static int json_skip(json_t *json) {
+    int c = json_peek(json);
+
+    if (c == '"') return json_string(json, NULL, 0);
+
+    if (c == '[' || c == '{') {
+        char close = c == '[' ? ']' : '}';
+        int count = 0;
+        int more;
+
+        json->p++;
+        while ((more = json_next(json, close, &count)) == 1) {
+            if (c == '{' && (json_string(json, NULL, 0) != 0 || json_expect(json, ':') != 0)) return -1;
+            if (json_skip(json) != 0) return -1;
+        }
+
+        return more;
+    }
+
+    const char *start = json->p;
+    while (json->p < json->end && (isalnum((unsigned char) *json->p) || strchr("+-.", *json->p) != NULL)) json->p++;
+
+    return json->p > start ? 0 : -1;
+}
+
+static int parse_ram(json_t *json, testvec_state_t *state) {
+    int count = 0;
+    int more;
+
+    if (json_expect(json, '[') != 0) return -1;
+
+    while ((more = json_next(json, ']', &count)) == 1) {
+        long address;
+        long value;
+
+        if (json_expect(json, '[') != 0 || json_number(json, &address) != 0 || json_expect(json, ',') != 0
+            || json_number(json, &value) != 0 || json_expect(json, ']') != 0) {
+            return -1;
+        }
+
+        if (state->ram_count == TESTVEC_MAX_RAM) return -1;
+
+        state->ram[state->ram_count].address = address;
+        state->ram[state->ram_count].value = value;
+        state->ram_count++;
+    }
+
+    return more;
+}
+
+static int parse_state(json_t *json, testvec_state_t *state) {
+    int count = 0;
+    int more;
+
+    memset(state, 0, sizeof(testvec_state_t));
+    if (json_expect(json, '{') != 0) return -1;
+
+    while ((more = json_next(json, '}', &count)) == 1) {
+        char key[16];
+        if (json_string(json, key, sizeof(key)) != 0 || json_expect(json, ':') != 0) return -1;
+
+        if (strcmp(key, "ram") == 0) {
+            if (parse_ram(json, state) != 0) return -1;
+            continue;
+        }
+
+        int reg = 0;
+        while (reg < REG_COUNT && strcmp(key, reg_names[reg]) != 0) reg++;
+
+        if (reg == REG_COUNT) {
+            if (json_skip(json) != 0) return -1;
+            continue;
+        }
+
+        long value;
+        if (json_number(json, &value) != 0) return -1;
+
+        state->reg[reg] = value;
+        state->present |= 1u << reg;
+    }
+
+    return more;
+}
+
+static int parse_vector(json_t *json, testvec_t *vector) {
+    int count = 0;
+    int more;
+
+    memset(vector, 0, sizeof(testvec_t));
+    if (json_expect(json, '{') != 0) return -1;
+
+    while ((more = json_next(json, '}', &count)) == 1) {
+        char key[16];
+        if (json_string(json, key, sizeof(key)) != 0 || json_expect(json, ':') != 0) return -1;
+
+        int status;
+        if (strcmp(key, "name") == 0) {
+            status = json_string(json, vector->name, sizeof(vector->name));
+        } else if (strcmp(key, "initial") == 0) {
+            status = parse_state(json, &vector->initial);
+        } else if (strcmp(key, "final") == 0) {
+            status = parse_state(json, &vector->final);
+        } else if (strcmp(key, "cycles") == 0) {
+            int cycles = 0;
+
+            status = json_expect(json, '[');
+            while (status == 0 && (status = json_next(json, ']', &cycles)) == 1) {
+                status = json_skip(json);
+            }
+
+            vector->bus_cycles = cycles;
+        } else {
+            status = json_skip(json);
+        }
+
+        if (status != 0) return -1;
+    }
+
+    return more;
+}
+
+static testvec_t *load_vectors(const char *path, long *count) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *text = length > 0 ? malloc(length + 1) : NULL;
+    if (text == NULL || fread(text, 1, length, file) != (size_t) length) {
+        free(text);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    text[length] = '\0';
+
+    json_t json = { text, text + length };
+    testvec_t *vectors = NULL;
+    long capacity = 0;
+    int elements = 0;
+    int more;
+
+    *count = 0;
+    if (json_expect(&json, '[') != 0) {
+        free(text);
+        return NULL;
+    }
+
+    while ((more = json_next(&json, ']', &elements)) == 1) {
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            vectors = realloc(vectors, capacity * sizeof(testvec_t));
+        }
+
+        if (parse_vector(&json, &vectors[*count]) != 0) break;
+        (*count)++;
+    }
+
+    free(text);
+
+    if (more != 0) {
+        free(vectors);
+        return NULL;
+    }
+
+    return vectors;
+}
+
+static uint8_t flags_to_byte(const cpu_t *cpu) {
+    return cpu->registers.w.F.z << 7 | cpu->registers.w.F.n << 6 | cpu->registers.w.F.h << 5
+           | cpu->registers.w.F.c << 4;
+}
+
+static void load_state(gameboy_t *gb, const testvec_state_t *state) {
+    cpu_t *cpu = &gb->cpu;
+
+    memset(cpu, 0, sizeof(cpu_t));
+    cpu->registers.w.A = state->reg[REG_A];
+    cpu->registers.w.B = state->reg[REG_B];
+    cpu->registers.w.C = state->reg[REG_C];
+    cpu->registers.w.D = state->reg[REG_D];
+    cpu->registers.w.E = state->reg[REG_E];
+    cpu->registers.w.H = state->reg[REG_H];
+    cpu->registers.w.L = state->reg[REG_L];
+    cpu->registers.w.F.z = state->reg[REG_F] >> 7 & 1;
+    cpu->registers.w.F.n = state->reg[REG_F] >> 6 & 1;
+    cpu->registers.w.F.h = state->reg[REG_F] >> 5 & 1;
+    cpu->registers.w.F.c = state->reg[REG_F] >> 4 & 1;
+    cpu->registers.dw.SP = state->reg[REG_SP];
+    cpu->registers.dw.PC = state->reg[REG_PC];
+    cpu->state.IME = state->reg[REG_IME] & 1;
+    gb->cycles = 0;
+
+    if (state->present & 1u << REG_IE) {
+        uint8_t ie = state->reg[REG_IE];
+        bus_copy_in(&gb->bus, 0xffff, &ie, 1);
+    }
+
+    for (int i = 0; i < state->ram_count; i++) {
+        bus_copy_in(&gb->bus, state->ram[i].address, &state->ram[i].value, 1);
+    }
+}
+
+// Writes the first difference to the expected state into detail. Returns 1 if there is none.
+static int check_state(const gameboy_t *gb, const testvec_state_t *state, char *detail, size_t size) {
+    const cpu_t *cpu = &gb->cpu;
+    const uint16_t actual[REG_COUNT] = {
+        cpu->registers.dw.PC, cpu->registers.dw.SP,
+        cpu->registers.w.A, cpu->registers.w.B, cpu->registers.w.C, cpu->registers.w.D, cpu->registers.w.E,
+        flags_to_byte(cpu), cpu->registers.w.H, cpu->registers.w.L,
+        cpu->state.IME, bus_read(&gb->bus, 0xffff),
+    };
+
+    for (int reg = 0; reg < REG_COUNT; reg++) {
+        if (!(state->present & 1u << reg) || actual[reg] == state->reg[reg]) continue;
+
+        snprintf(detail, size, "%s is %x, expected %x", reg_names[reg], actual[reg], state->reg[reg]);
+        return 0;
+    }
+
+    for (int i = 0; i < state->ram_count; i++) {
+        uint8_t value = bus_read(&gb->bus, state->ram[i].address);
+        if (value == state->ram[i].value) continue;
+
+        snprintf(detail, size, "(%04x) is %02x, expected %02x", state->ram[i].address, value, state->ram[i].value);
+        return 0;
+    }
+
+    return 1;
+}
+
+static void capture(gameboy_t *gb, backend_outcome_t *outcome, uint8_t *touched) {
+    memcpy(touched, gb->bus.dirty, BUS_PAGE_COUNT);
+    backend_capture(gb, outcome);
+}
+
+// Hashing the wiped pages right away leaves none of them dirty, so the next vector only sees its own.
+static void wipe(gameboy_t *gb, const uint8_t *touched) {
+    static const uint8_t zero[BUS_PAGE_SIZE];
+    uint64_t root[2];
+
+    for (int page = 0; page < BUS_PAGE_COUNT; page++) {
+        if (touched[page]) bus_copy_in(&gb->bus, page << 8, zero, BUS_PAGE_SIZE);
+    }
+
+    bus_fingerprint(&gb->bus, root);
+}
+
+static void record_mismatch(file_job_t *job, const testvec_t *vector, backend_t backend, int *counted) {
+    job->mismatches_by_backend[backend]++;
+
+    if (!*counted) {
+        job->backend_mismatches++;
+        *counted = 1;
+    }
+
+    if (job->mismatch[0] == '\0') {
+        snprintf(job->mismatch, sizeof(job->mismatch), "%s: %s differs from tick", vector->name,
+                 backend_names[backend]);
+    }
+}
+
+// Runs up to CPU_LANES_MAX vectors, so the lockstep lanes get them all in one step.
+static void run_batch(worker_t *worker, file_job_t *job, const testvec_t *vectors, int count) {
+    backend_outcome_t reference[CPU_LANES_MAX];
+    uint8_t touched[BUS_PAGE_COUNT];
+    int mismatched[CPU_LANES_MAX] = { 0 };
+
+    for (int i = 0; i < count; i++) {
+        const testvec_t *vector = &vectors[i];
+
+        for (int backend = 0; backend < BACKEND_LANES; backend++) {
+            gameboy_t *gb = worker->scalar[backend];
+            backend_outcome_t outcome;
+
+            load_state(gb, &vector->initial);
+            backend_execute(backend, gb, &worker->probes);
+            capture(gb, &outcome, touched);
+
+            if (backend == BACKEND_TICK) {
+                char detail[160];
+
+                reference[i] = outcome;
+                if (check_state(gb, &vector->final, detail, sizeof(detail))) {
+                    job->passed++;
+                } else if (job->failure[0] == '\0') {
+                    snprintf(job->failure, sizeof(job->failure), "%s: %s", vector->name, detail);
+                }
+
+                // outcome.cycles comes from the timing table, not from the bus accesses cpu_tick() made.
+                if (vector->bus_cycles * 4 != (int) outcome.cycles) job->timing_mismatches++;
+            } else if (backend_compare(&outcome, &reference[i]) != NULL) {
+                record_mismatch(job, vector, backend, &mismatched[i]);
+            }
+
+            wipe(gb, touched);
+        }
+
+        load_state(worker->lanes[i], &vector->initial);
+    }
+
+    lockstep_init(&worker->lockstep, worker->lanes, count);
+    lockstep_step_cpu(&worker->lockstep);
+
+    for (int i = 0; i < count; i++) {
+        backend_outcome_t outcome;
+
+        capture(worker->lanes[i], &outcome, touched);
+        if (backend_compare(&outcome, &reference[i]) != NULL) record_mismatch(job, &vectors[i], BACKEND_LANES, &mismatched[i]);
+
+        wipe(worker->lanes[i], touched);
+    }
+}
+
+static gameboy_t *create_blank(void) {
+    gameboy_t *gb = gameboy_create();
+    uint64_t root[2];
+
+    bus_clear(&gb->bus);
+    bus_set_rom_writable(&gb->bus, 1);
+    bus_fingerprint(&gb->bus, root);
+
+    return gb;
+}
+
+static worker_t *worker_create(void) {
+    worker_t *worker = calloc(1, sizeof(worker_t));
+
+    for (int i = 0; i < BACKEND_LANES; i++) worker->scalar[i] = create_blank();
+    for (int i = 0; i < CPU_LANES_MAX; i++) worker->lanes[i] = create_blank();
+
+    backend_probes_init(&worker->probes, worker->coverage);
+
+    return worker;
+}
+
+static void worker_destroy(worker_t *worker) {
+    if (worker == NULL) return;
+
+    for (int i = 0; i < BACKEND_LANES; i++) gameboy_destroy(worker->scalar[i]);
+    for (int i = 0; i < CPU_LANES_MAX; i++) gameboy_destroy(worker->lanes[i]);
+
+    free(worker);
+}
+
+static void run_file(void *arg, int worker_id) {
+    file_job_t *job = arg;
+    testvec_run_t *run = job->run;
+
+    if (run->workers[worker_id] == NULL) run->workers[worker_id] = worker_create();
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", run->dir, job->name);
+
+    testvec_t *vectors = load_vectors(path, &job->vectors);
+    if (vectors == NULL) {
+        job->failed = 1;
+        return;
+    }
+
+    for (long i = 0; i < job->vectors; i += CPU_LANES_MAX) {
+        long count = job->vectors - i < CPU_LANES_MAX ? job->vectors - i : CPU_LANES_MAX;
+        run_batch(run->workers[worker_id], job, vectors + i, (int) count);
+    }
+
+    free(vectors);
+}
+
+static int compare_jobs(const void *a, const void *b) {
+    return strcmp(((const file_job_t *) a)->name, ((const file_job_t *) b)->name);
+}
+
+static int list_files(testvec_run_t *run) {
+    DIR *dir = opendir(run->dir);
+    if (dir == NULL) return -1;
+
+    size_t capacity = 0;
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length < 6 || length >= sizeof(run->jobs[0].name) || strcmp(entry->d_name + length - 5, ".json") != 0) {
+            continue;
+        }
+
+        if (run->job_count == capacity) {
+            capacity = capacity ? capacity * 2 : 512;
+            run->jobs = realloc(run->jobs, capacity * sizeof(file_job_t));
+        }
+
+        file_job_t *job = &run->jobs[run->job_count++];
+        memset(job, 0, sizeof(file_job_t));
+        job->run = run;
+        strcpy(job->name, entry->d_name);
+    }
+
+    closedir(dir);
+    qsort(run->jobs, run->job_count, sizeof(file_job_t), compare_jobs);
+
+    return 0;
+}
+
+int testvec_run(const char *dir, int threads, int verbose, FILE *out) {
+    testvec_run_t run = { dir, NULL, 0, NULL };
+
+    if (list_files(&run) != 0 || run.job_count == 0) {
+        free(run.jobs);
+        return -1;
+    }
+
+    pool_t *pool = pool_create(threads);
+    run.workers = calloc(pool_size(pool), sizeof(worker_t *));
+
+    for (size_t i = 0; i < run.job_count; i++) {
+        pool_submit(pool, run_file, &run.jobs[i]);
+    }
+
+    pool_wait(pool);
+
+    long vectors = 0;
+    long passed = 0;
+    long timing_mismatches = 0;
+    long backend_mismatches = 0;
+    int unreadable = 0;
+
+    for (size_t i = 0; i < run.job_count; i++) {
+        file_job_t *job = &run.jobs[i];
+
+        if (job->failed) {
+            fprintf(out, "%s unreadable\n", job->name);
+            unreadable = 1;
+            continue;
+        }
+
+        fprintf(out, "%s %ld %ld %ld %ld\n", job->name, job->vectors, job->passed, job->timing_mismatches,
+                job->backend_mismatches);
+
+        if (verbose && job->failure[0] != '\0') fprintf(out, "  %s\n", job->failure);
+        if (verbose && job->mismatch[0] != '\0') fprintf(out, "  %s\n", job->mismatch);
+
+        vectors += job->vectors;
+        passed += job->passed;
+        timing_mismatches += job->timing_mismatches;
+        backend_mismatches += job->backend_mismatches;
+    }
+
+    fprintf(out, "total %ld %ld %ld %ld\n", vectors, passed, timing_mismatches, backend_mismatches);
+
+    for (int backend = 1; backend < BACKEND_COUNT; backend++) {
+        long mismatches = 0;
+        for (size_t i = 0; i < run.job_count; i++) mismatches += run.jobs[i].mismatches_by_backend[backend];
+
+        if (mismatches > 0) fprintf(out, "%s disagrees with tick on %ld vectors\n", backend_names[backend], mismatches);
+    }
+
+    for (int i = 0; i < pool_size(pool); i++) {
+        worker_destroy(run.workers[i]);
+    }
+
+    pool_destroy(pool);
+    free(run.workers);
+    free(run.jobs);
+
+    if (unreadable) return -1;
+    return backend_mismatches > 0 ? 1 : 0;
+}
@@ -0,0 +1,21 @@
+#ifndef CGAMEBOY_TESTVEC_H
+#define CGAMEBOY_TESTVEC_H
+
+#include <stdio.h>
+
+// Runs single-step CPU test vectors: JSON files holding an array of
+// { "name", "initial": { pc, sp, a, b, c, d, e, f, h, l, ime, ie, ram: [[address, value], ...] }, "final": {...},
+//   "cycles": [...] }, one file per opcode like the SingleStepTests sm83 set.
+//
+// Every vector runs on every backend: cpu_tick(), its coverage/calls instantiations and the lockstep vector lanes.
+// Backends are compared with cpu_tick() on all registers and the whole address space, cpu_tick() is compared with the
+// final state. The timing table entry of the opcode is compared with the length of the vector's "cycles" list, the
+// per-cycle bus activity in that list isn't checked: the backends don't report their bus accesses. Files are spread
+// over a pool of threads, one line per file is printed:
+// "<file> <vectors> <passed> <timing-table mismatches> <backend mismatches>".
+//
+// Returns 0 if all backends agree, 1 if any doesn't and -1 if the directory or a file couldn't be read. Failing
+// vectors alone don't fail the run, the interpreter doesn't match the hardware yet.
+int testvec_run(const char *dir, int threads, int verbose, FILE *out);
+
+#endif //CGAMEBOY_TESTVEC_H
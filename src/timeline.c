@@ -0,0 +1,157 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "timeline.h"
+
+#define TIMELINE_MAX_EVENTS (1 << 20) // Per thread, later events are counted as dropped.
+
+typedef struct {
+    const char *name;
+    uint64_t begin;
+    uint64_t end;
+} timeline_event_t;
+
+typedef struct timeline_thread {
+    timeline_event_t *events;
+    size_t count;
+    size_t capacity;
+    size_t dropped;
+    int tid;
+
+    struct timeline_thread *next;
+} timeline_thread_t;
+
+atomic_int timeline_enabled = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static timeline_thread_t *threads = NULL;
+static int thread_count = 0;
+static FILE *file = NULL;
+static atomic_uint_fast64_t origin = 0;
+
+// Bumped on every open and close, so buffers of an earlier timeline aren't reused after it was closed and freed.
+static atomic_int generation = 0;
+static _Thread_local timeline_thread_t *local = NULL;
+static _Thread_local int local_generation = 0;
+
+uint64_t timeline_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int timeline_open(const char *path) {
+    pthread_mutex_lock(&lock);
+
+    if (file != NULL || (file = fopen(path, "w")) == NULL) {
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    atomic_store(&origin, timeline_now());
+    generation++;
+    atomic_store(&timeline_enabled, 1);
+
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+static timeline_thread_t *register_thread(void) {
+    timeline_thread_t *thread = calloc(1, sizeof(timeline_thread_t));
+
+    pthread_mutex_lock(&lock);
+    thread->tid = ++thread_count;
+    thread->next = threads;
+    threads = thread;
+    local_generation = atomic_load(&generation);
+    pthread_mutex_unlock(&lock);
+
+    return thread;
+}
+
+void timeline_record(const char *name, uint64_t begin) {
+    uint64_t end = timeline_now();
+
+    // Scopes that began before this timeline was opened, or end after it was closed, belong to no open timeline.
+    if (!atomic_load_explicit(&timeline_enabled, memory_order_acquire) ||
+        begin < atomic_load_explicit(&origin, memory_order_relaxed)) {
+        return;
+    }
+
+    if (local == NULL || local_generation != atomic_load_explicit(&generation, memory_order_relaxed)) {
+        local = register_thread();
+    }
+
+    timeline_thread_t *thread = local;
+
+    if (thread->count == thread->capacity) {
+        if (thread->capacity == TIMELINE_MAX_EVENTS) {
+            thread->dropped++;
+            return;
+        }
+
+        thread->capacity = thread->capacity ? thread->capacity * 2 : 4096;
+        thread->events = realloc(thread->events, thread->capacity * sizeof(timeline_event_t));
+    }
+
+    timeline_event_t *event = &thread->events[thread->count++];
+    event->name = name;
+    event->begin = begin;
+    event->end = end;
+}
+
+// Trace-event timestamps are in microseconds, fractions keep the nanoseconds.
+static void write_us(uint64_t ns) {
+    fprintf(file, "%llu.%03llu", (unsigned long long) (ns / 1000), (unsigned long long) (ns % 1000));
+}
+
+int timeline_close(void) {
+    pthread_mutex_lock(&lock);
+
+    if (file == NULL) {
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    atomic_store(&timeline_enabled, 0);
+    generation++;
+
+    uint64_t start = atomic_load(&origin);
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"CGameBoy\"}}");
+
+    while (threads != NULL) {
+        timeline_thread_t *thread = threads;
+
+        fprintf(file, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"thread %d%s\"}}",
+                thread->tid, thread->tid, thread->dropped ? " (events dropped)" : "");
+
+        for (size_t i = 0; i < thread->count; i++) {
+            const timeline_event_t *event = &thread->events[i];
+            uint64_t begin = event->begin - start;
+
+            fprintf(file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":", thread->tid, event->name);
+            write_us(begin);
+            fprintf(file, ",\"dur\":");
+            write_us(event->end - event->begin);
+            fprintf(file, "}");
+        }
+
+        threads = thread->next;
+        free(thread->events);
+        free(thread);
+    }
+
+    fprintf(file, "\n]}\n");
+
+    int status = fclose(file) == 0 ? 0 : -1;
+    file = NULL;
+    thread_count = 0;
+
+    pthread_mutex_unlock(&lock);
+    return status;
+}
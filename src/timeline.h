@@ -0,0 +1,35 @@
+#ifndef CGAMEBOY_TIMELINE_H
+#define CGAMEBOY_TIMELINE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Opt-in host time scopes around the subsystems, written as Chrome trace-event JSON for chrome://tracing or Perfetto.
+// Every thread records into its own buffer, the only shared step is registering that buffer on its first event.
+//
+//   uint64_t begin = timeline_begin();
+//   ...
+//   timeline_end("cpu", begin);
+//
+// Costs one load and branch per scope while no timeline is open. Names must be string literals.
+extern atomic_int timeline_enabled;
+
+// Starts recording on all threads. Returns -1 if path can't be written.
+int timeline_open(const char *path);
+
+// Writes the file and stops recording. Scopes that are still open at this point are dropped when they end, even if
+// another timeline has been opened by then. Must not race with timeline_end, so call it after the pools are gone.
+int timeline_close(void);
+
+uint64_t timeline_now(void);
+void timeline_record(const char *name, uint64_t begin);
+
+static inline uint64_t timeline_begin(void) {
+    return atomic_load_explicit(&timeline_enabled, memory_order_relaxed) ? timeline_now() : 0;
+}
+
+static inline void timeline_end(const char *name, uint64_t begin) {
+    if (begin != 0) timeline_record(name, begin);
+}
+
+#endif //CGAMEBOY_TIMELINE_H
@@ -0,0 +1,255 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "trace.h"
+
+#define TRACE_BLOCK_RECORDS 4096
+#define TRACE_MASK_SIZE ((sizeof(trace_record_t) + 7) / 8)
+
+_Static_assert(sizeof(trace_record_t) == 24, "trace records must not contain padding");
+
+// File header, followed by blocks of "uint32 records, uint32 bytes, payload". Every record in a payload is a bitmask
+// of the bytes that differ from the previous record, then those bytes. The previous record starts out zeroed in
+// every block.
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t record_size;
+} trace_header_t;
+
+static size_t encode(const trace_record_t *record, uint8_t *previous, uint8_t *out) {
+    const uint8_t *bytes = (const uint8_t *) record;
+    size_t length = TRACE_MASK_SIZE;
+
+    for (size_t word = 0; word < TRACE_MASK_SIZE; word++) {
+        uint64_t current;
+        uint64_t last;
+        uint8_t mask = 0;
+
+        memcpy(&current, bytes + word * 8, 8);
+        memcpy(&last, previous + word * 8, 8);
+
+        // Most words are unchanged apart from the cycle counter and PC, so skip those without looking at each byte.
+        for (uint64_t diff = current ^ last; diff != 0;) {
+            int i = __builtin_ctzll(diff) / 8;
+
+            mask |= 1 << i;
+            diff &= ~(0xffULL << (i * 8));
+        }
+
+        for (int i = 0; i < 8; i++) {
+            if (mask & 1 << i) out[length++] = bytes[word * 8 + i];
+        }
+
+        out[word] = mask;
+    }
+
+    memcpy(previous, bytes, sizeof(trace_record_t));
+    return length;
+}
+
+static void *writer(void *arg) {
+    trace_t *trace = arg;
+    uint8_t *block = malloc(TRACE_BLOCK_RECORDS * (TRACE_MASK_SIZE + sizeof(trace_record_t)) + 1);
+
+    for (;;) {
+        int stopping = atomic_load_explicit(&trace->stop, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&trace->tail, memory_order_relaxed);
+        size_t available = atomic_load_explicit(&trace->head, memory_order_acquire) - tail;
+
+        if (available == 0) {
+            if (stopping) break;
+
+            // The timeout picks up partial rings, a wakeup only comes once a quarter of it is filled.
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += 5000000;
+            if (until.tv_nsec >= 1000000000) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000;
+            }
+
+            pthread_mutex_lock(&trace->lock);
+            atomic_store(&trace->writer_sleeping, 1);
+
+            if (atomic_load(&trace->head) == tail && !atomic_load(&trace->stop)) {
+                pthread_cond_timedwait(&trace->wake, &trace->lock, &until);
+            }
+
+            atomic_store(&trace->writer_sleeping, 0);
+            pthread_mutex_unlock(&trace->lock);
+            continue;
+        }
+
+        uint32_t count = available < TRACE_BLOCK_RECORDS ? (uint32_t) available : TRACE_BLOCK_RECORDS;
+        uint8_t previous[sizeof(trace_record_t)] = { 0 };
+        uint32_t length = 0;
+
+        for (uint32_t i = 0; i < count; i++) {
+            length += (uint32_t) encode(&trace->ring[(tail + i) & (TRACE_RING_SIZE - 1)], previous, block + length);
+        }
+
+        atomic_store(&trace->tail, tail + count);
+
+        if (atomic_load(&trace->producer_waiting)) {
+            pthread_mutex_lock(&trace->lock);
+            pthread_cond_signal(&trace->space);
+            pthread_mutex_unlock(&trace->lock);
+        }
+
+        if (!trace->failed && (fwrite(&count, sizeof(count), 1, trace->file) != 1
+                               || fwrite(&length, sizeof(length), 1, trace->file) != 1
+                               || fwrite(block, 1, length, trace->file) != length)) {
+            trace->failed = 1;
+        }
+    }
+
+    free(block);
+    return NULL;
+}
+
+trace_t *trace_open(const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return NULL;
+
+    trace_header_t header = { { 0 }, TRACE_VERSION, sizeof(trace_record_t) };
+    memcpy(header.magic, TRACE_MAGIC, 4);
+
+    trace_t *trace = malloc(sizeof(trace_t));
+    atomic_init(&trace->head, 0);
+    atomic_init(&trace->tail, 0);
+    atomic_init(&trace->stop, 0);
+    atomic_init(&trace->writer_sleeping, 0);
+    atomic_init(&trace->producer_waiting, 0);
+    pthread_mutex_init(&trace->lock, NULL);
+    pthread_cond_init(&trace->wake, NULL);
+    pthread_cond_init(&trace->space, NULL);
+    trace->file = file;
+    trace->failed = fwrite(&header, sizeof(header), 1, file) != 1;
+
+    if (pthread_create(&trace->writer, NULL, writer, trace) != 0) {
+        pthread_mutex_destroy(&trace->lock);
+        pthread_cond_destroy(&trace->wake);
+        pthread_cond_destroy(&trace->space);
+        fclose(file);
+        free(trace);
+        return NULL;
+    }
+
+    return trace;
+}
+
+int trace_close(trace_t *trace) {
+    pthread_mutex_lock(&trace->lock);
+    atomic_store(&trace->stop, 1);
+    pthread_cond_signal(&trace->wake);
+    pthread_mutex_unlock(&trace->lock);
+
+    pthread_join(trace->writer, NULL);
+
+    int failed = trace->failed;
+    if (fclose(trace->file) != 0) failed = 1;
+
+    pthread_mutex_destroy(&trace->lock);
+    pthread_cond_destroy(&trace->wake);
+    pthread_cond_destroy(&trace->space);
+
+    free(trace);
+    return failed ? -1 : 0;
+}
+
+void trace_wait(trace_t *trace) {
+    size_t head = atomic_load_explicit(&trace->head, memory_order_relaxed);
+
+    pthread_mutex_lock(&trace->lock);
+    atomic_store(&trace->producer_waiting, 1);
+    pthread_cond_signal(&trace->wake);
+
+    while (head - atomic_load(&trace->tail) == TRACE_RING_SIZE) {
+        pthread_cond_wait(&trace->space, &trace->lock);
+    }
+
+    atomic_store(&trace->producer_waiting, 0);
+    pthread_mutex_unlock(&trace->lock);
+}
+
+void trace_wake(trace_t *trace) {
+    pthread_mutex_lock(&trace->lock);
+    pthread_cond_signal(&trace->wake);
+    pthread_mutex_unlock(&trace->lock);
+}
+
+static void print_record(FILE *out, const trace_record_t *record) {
+    const char *name = record->opcode == 0xcb ? cpu_cb_ops[record->cb_opcode].name : cpu_ops[record->opcode].name;
+    const uint8_t *r = record->registers;
+
+    fprintf(out, "%12" PRIu64 " %04x  %-14s A=%02x F=%02x BC=%02x%02x DE=%02x%02x HL=%02x%02x SP=%04x%s%s\n",
+            record->cycles, record->pc, name != NULL ? name : "(illegal)", r[0], r[1], r[2], r[3], r[4], r[5],
+            r[6], r[7], record->sp, record->state & 0b001 ? " IME" : "", record->state & 0b110 ? " HALT" : "");
+}
+
+int trace_dump(const char *path, FILE *out, uint64_t limit) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return -1;
+
+    trace_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, TRACE_MAGIC, 4) != 0
+        || header.version != TRACE_VERSION || header.record_size != sizeof(trace_record_t)) {
+        fclose(file);
+        return -1;
+    }
+
+    uint8_t *block = malloc(TRACE_BLOCK_RECORDS * (TRACE_MASK_SIZE + sizeof(trace_record_t)));
+    uint64_t printed = 0;
+    int status = 0;
+    uint32_t count;
+    uint32_t length;
+
+    while (fread(&count, sizeof(count), 1, file) == 1) {
+        if (fread(&length, sizeof(length), 1, file) != 1 || count > TRACE_BLOCK_RECORDS
+            || length > TRACE_BLOCK_RECORDS * (TRACE_MASK_SIZE + sizeof(trace_record_t))
+            || fread(block, 1, length, file) != length) {
+            status = -1;
+            break;
+        }
+
+        trace_record_t record;
+        uint8_t *bytes = (uint8_t *) &record;
+        size_t pos = 0;
+
+        memset(&record, 0, sizeof(record));
+
+        for (uint32_t i = 0; i < count && (limit == 0 || printed < limit); i++) {
+            if (pos + TRACE_MASK_SIZE > length) {
+                status = -1;
+                break;
+            }
+
+            const uint8_t *mask = block + pos;
+            pos += TRACE_MASK_SIZE;
+
+            for (size_t j = 0; j < sizeof(trace_record_t); j++) {
+                if (mask[j / 8] & 1 << (j % 8)) {
+                    if (pos >= length) {
+                        status = -1;
+                        break;
+                    }
+
+                    bytes[j] = block[pos++];
+                }
+            }
+
+            if (status != 0) break;
+
+            print_record(out, &record);
+            printed++;
+        }
+
+        if (status != 0 || (limit != 0 && printed >= limit)) break;
+    }
+
+    free(block);
+    fclose(file);
+    return status;
+}
@@ -0,0 +1,86 @@
+#ifndef CGAMEBOY_TRACE_H
+#define CGAMEBOY_TRACE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gameboy.h"
+
+#define TRACE_MAGIC "CGBT"
+#define TRACE_VERSION 1
+#define TRACE_RING_SIZE 65536
+
+// State right before an instruction executes. Multi-byte fields are in host byte order.
+typedef struct {
+    uint64_t cycles;
+    uint16_t pc;
+    uint16_t sp;
+    uint8_t opcode;
+    uint8_t cb_opcode;
+    uint8_t registers[8]; // A, F, B, C, D, E, H, L
+    uint8_t state;        // IME | halted << 1 | stopped << 2
+    uint8_t joypad;
+} trace_record_t;
+
+// The emulation thread is the only producer and the writer thread the only consumer of the ring, so both sides only
+// need their own index plus an acquire load of the other one. The writer XORs every record with the one before it and
+// stores only the bytes that changed, in blocks that can be decoded on their own.
+struct trace {
+    trace_record_t ring[TRACE_RING_SIZE];
+    atomic_size_t head;
+    atomic_size_t tail;
+    atomic_int stop;
+
+    // Only used to sleep, never on the fast path. The producer wakes the writer every quarter ring and blocks when the
+    // ring is full, the writer wakes it again once it made room.
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t space;
+    atomic_int writer_sleeping;
+    atomic_int producer_waiting;
+
+    FILE *file;
+    pthread_t writer;
+    int failed;
+};
+
+// Starts the writer thread. Returns NULL if the file can't be created.
+trace_t *trace_open(const char *path);
+// Drains the ring, stops the writer and closes the file. Returns -1 if anything couldn't be written.
+int trace_close(trace_t *trace);
+
+// Slow paths of trace_record().
+void trace_wait(trace_t *trace);
+void trace_wake(trace_t *trace);
+
+// Prints every record of a trace file as text, at most limit records if limit isn't 0.
+int trace_dump(const char *path, FILE *out, uint64_t limit);
+
+static inline void trace_record(trace_t *trace, const gameboy_t *gb, uint8_t opcode, uint8_t cb_opcode) {
+    size_t head = atomic_load_explicit(&trace->head, memory_order_relaxed);
+
+    if (head - atomic_load_explicit(&trace->tail, memory_order_acquire) == TRACE_RING_SIZE) {
+        trace_wait(trace);
+    }
+
+    trace_record_t *record = &trace->ring[head & (TRACE_RING_SIZE - 1)];
+    record->cycles = gb->cycles;
+    record->pc = gb->cpu.registers.dw.PC;
+    record->sp = gb->cpu.registers.dw.SP;
+    record->opcode = opcode;
+    record->cb_opcode = opcode == 0xcb ? cb_opcode : 0;
+    memcpy(record->registers, &gb->cpu.registers, sizeof(record->registers));
+    record->state = gb->cpu.state.IME | gb->cpu.state.halted << 1 | gb->cpu.state.stopped << 2;
+    record->joypad = gb->joypad;
+
+    atomic_store_explicit(&trace->head, head + 1, memory_order_release);
+
+    if (((head + 1) & (TRACE_RING_SIZE / 4 - 1)) == 0 && atomic_load(&trace->writer_sleeping)) {
+        trace_wake(trace);
+    }
+}
+
+#endif //CGAMEBOY_TRACE_H
@@ -0,0 +1,108 @@
+#include <string.h>
+
+#include "components/ppu.h"
+#include "simd.h"
+#include "timeline.h"
+#include "video.h"
+
+const video_palette_t video_palette_grey = { { 0xffffff, 0xaaaaaa, 0x555555, 0x000000 } };
+const video_palette_t video_palette_dmg = { { 0x9bbc0f, 0x8bac0f, 0x306230, 0x0f380f } };
+const video_palette_t video_palette_pocket = { { 0xc4cfa1, 0x8b956d, 0x4d533c, 0x1f1f1f } };
+const video_palette_t video_palette_cgb = { { 0xffffff, 0x7bff31, 0x0063c5, 0x000000 } };
+
+int video_pixel_size(video_format_t format) {
+    return format == VIDEO_RGB565 ? 2 : 4;
+}
+
+static uint32_t pack(uint32_t rgb, video_format_t format) {
+    uint32_t r = rgb >> 16 & 0xff;
+    uint32_t g = rgb >> 8 & 0xff;
+    uint32_t b = rgb & 0xff;
+
+    switch (format) {
+        case VIDEO_RGBA8888: {
+            uint8_t bytes[4] = { (uint8_t) r, (uint8_t) g, (uint8_t) b, 0xff };
+            uint32_t pixel;
+
+            memcpy(&pixel, bytes, sizeof(pixel));
+            return pixel;
+        }
+
+        case VIDEO_BGRA8888: {
+            uint8_t bytes[4] = { (uint8_t) b, (uint8_t) g, (uint8_t) r, 0xff };
+            uint32_t pixel;
+
+            memcpy(&pixel, bytes, sizeof(pixel));
+            return pixel;
+        }
+
+        default: return (r >> 3) << 11 | (g >> 2) << 5 | b >> 3;
+    }
+}
+
+// The per-pixel lookup is written as a chain of selects over four colours instead of a table load, which compiles into
+// compares and blends across a whole vector of pixels.
+#define VIDEO_ROW(name, type) \
+    static inline __attribute__((always_inline)) void name(const uint8_t *src, type *dst, const uint32_t *colors, \
+                                                           const int scale) { \
+        type c0 = (type) colors[0], c1 = (type) colors[1], c2 = (type) colors[2], c3 = (type) colors[3]; \
+        \
+        for (int x = 0; x < PPU_WIDTH; x++) { \
+            uint8_t shade = src[x]; \
+            type color = shade == 0 ? c0 : shade == 1 ? c1 : shade == 2 ? c2 : c3; \
+            \
+            for (int i = 0; i < scale; i++) dst[x * scale + i] = color; \
+        } \
+    }
+
+VIDEO_ROW(row32, uint32_t)
+VIDEO_ROW(row16, uint16_t)
+
+// Every source row is converted once, the other rows it scales to are copies of the first.
+#define VIDEO_FRAME(name, row, type, scale) \
+    SIMD_KERNEL \
+    static void name(const uint8_t *framebuffer, const uint32_t *colors, uint8_t *dst, size_t pitch) { \
+        for (int y = 0; y < PPU_HEIGHT; y++) { \
+            uint8_t *out = dst + (size_t) y * (scale) * pitch; \
+            row(framebuffer + y * PPU_WIDTH, (type *) out, colors, scale); \
+            \
+            for (int i = 1; i < (scale); i++) memcpy(out + i * pitch, out, PPU_WIDTH * (scale) * sizeof(type)); \
+        } \
+    }
+
+#define VIDEO_SCALES(X) X(1) X(2) X(3) X(4)
+
+#define VIDEO_VARIANT(scale) \
+    VIDEO_FRAME(frame32_##scale, row32, uint32_t, scale) \
+    VIDEO_FRAME(frame16_##scale, row16, uint16_t, scale)
+
+#define VIDEO_VARIANT_ENTRY(scale) [scale] = { frame32_##scale, frame16_##scale },
+
+VIDEO_SCALES(VIDEO_VARIANT)
+
+static const struct {
+    void (*frame32)(const uint8_t *framebuffer, const uint32_t *colors, uint8_t *dst, size_t pitch);
+    void (*frame16)(const uint8_t *framebuffer, const uint32_t *colors, uint8_t *dst, size_t pitch);
+} variants[VIDEO_SCALE_MAX + 1] = {
+    VIDEO_SCALES(VIDEO_VARIANT_ENTRY)
+};
+
+int video_convert(const uint8_t *framebuffer, const video_palette_t *palette, video_format_t format, int scale,
+                  void *dst, size_t pitch) {
+    uint32_t colors[4];
+
+    if (scale < 1 || scale > VIDEO_SCALE_MAX) return -1;
+
+    uint64_t begin = timeline_begin();
+
+    for (int i = 0; i < 4; i++) colors[i] = pack(palette->colors[i], format);
+
+    if (format == VIDEO_RGB565) {
+        variants[scale].frame16(framebuffer, colors, dst, pitch);
+    } else {
+        variants[scale].frame32(framebuffer, colors, dst, pitch);
+    }
+
+    timeline_end("present", begin);
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef CGAMEBOY_VIDEO_H
+#define CGAMEBOY_VIDEO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VIDEO_SCALE_MAX 4
+
+typedef enum {
+    VIDEO_RGBA8888, // Bytes R, G, B, A in memory.
+    VIDEO_BGRA8888, // Bytes B, G, R, A in memory.
+    VIDEO_RGB565,   // Native endian 16 bit words.
+} video_format_t;
+
+// Four 0xRRGGBB colours, lightest shade first.
+typedef struct {
+    uint32_t colors[4];
+} video_palette_t;
+
+extern const video_palette_t video_palette_grey;
+extern const video_palette_t video_palette_dmg;    // The green of the original LCD.
+extern const video_palette_t video_palette_pocket;
+extern const video_palette_t video_palette_cgb;    // What a CGB shows for DMG games without a palette of their own.
+
+// Bytes per pixel of format.
+int video_pixel_size(video_format_t format);
+
+// Output stage from the PPU framebuffer (PPU_WIDTH * PPU_HEIGHT shades) straight into dst, e.g. a mapped texture:
+// palette lookup and nearest neighbour upscaling by 1 to VIDEO_SCALE_MAX in one pass. pitch is the distance between
+// rows of dst in bytes. Returns -1 for an unsupported scale.
+int video_convert(const uint8_t *framebuffer, const video_palette_t *palette, video_format_t format, int scale,
+                  void *dst, size_t pitch);
+
+#endif //CGAMEBOY_VIDEO_H
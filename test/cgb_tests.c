@@ -0,0 +1,735 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "asm.h"
+#include "gameboy.h"
+#include "movie.h"
+#include "rewind.h"
+#include "savestate.h"
+#include "scaler.h"
+#include "symprof.h"
+#include "timeline.h"
+#include "video.h"
+
+// Behaviour checks run by ctest, one case per invocation: cgb_tests <case>. Each case returns 0 on success and
+// reports the first failed check.
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            return -1; \
+        } \
+    } while (0)
+
+// Touches WRAM ($c0c0-$dfdf) every iteration, depends on the joypad and LY, and goes through CALL/RET and PUSH/POP, so every
+// frame leaves a different state behind. Only symmetric 16-bit immediates, this core reads them high byte first.
+static const char test_rom_source[] =
+    "    org $100\n"
+    "    scf\n"
+    "    jr c, main\n"
+    "\n"
+    "    org $150\n"
+    "main:\n"
+    "    ld a, $20\n"
+    "    ldh [$00], a\n"
+    "    ld hl, $c0c0\n"
+    "loop:\n"
+    "    ldh a, [$00]\n"
+    "    add a, b\n"
+    "    ld b, a\n"
+    "    ldh a, [$44]\n"
+    "    xor b\n"
+    "    ld [hl], a\n"
+    "    inc hl\n"
+    "    ld a, h\n"
+    "    and $1f\n"
+    "    or $c0\n"
+    "    ld h, a\n"
+    "    ld a, l\n"
+    "    and $1f\n"
+    "    or $c0\n"
+    "    ld l, a\n"
+    "    call count\n"
+    "    scf\n"
+    "    jr c, loop\n"
+    "\n"
+    "    org $2020\n"
+    "count:\n"
+    "    push hl\n"
+    "    ld hl, $d0d0\n"
+    "    inc [hl]\n"
+    "    pop hl\n"
+    "    ret\n";
+
+static gameboy_t *create_test_machine(void) {
+    uint8_t *rom = calloc(1, GAMEBOY_ROM_SIZE);
+    asm_error_t error;
+
+    if (asm_assemble(test_rom_source, rom, GAMEBOY_ROM_SIZE, &error) < 0) {
+        fprintf(stderr, "test ROM:%d: %s\n", error.line, error.message);
+        free(rom);
+        return NULL;
+    }
+
+    gameboy_t *gb = gameboy_create();
+    gameboy_reset(gb, rom, GAMEBOY_ROM_SIZE);
+    free(rom);
+
+    return gb;
+}
+
+static uint8_t test_input(uint64_t frame) {
+    return (uint8_t) (frame / 7 % 3 == 0 ? JOYPAD_RIGHT : frame % 5 == 0 ? JOYPAD_UP | JOYPAD_LEFT : 0);
+}
+
+static void run_frames(gameboy_t *gb, int frames) {
+    for (int i = 0; i < frames; i++) {
+        gb->joypad = test_input(gb->frames);
+        gameboy_run_frame(gb);
+    }
+}
+
+static int fingerprint_equal(gameboy_fingerprint_t a, gameboy_fingerprint_t b) {
+    return a.lo == b.lo && a.hi == b.hi;
+}
+
+static int test_bus_clone(void) {
+    gameboy_t *gb = create_test_machine();
+    CHECK(gb != NULL);
+    run_frames(gb, 10);
+
+    gameboy_t *clone = gameboy_clone(gb);
+
+    // A fresh clone shares every chunk.
+    for (int i = 0; i < BUS_CHUNK_COUNT; i++) {
+        CHECK(clone->bus.chunks[i] == gb->bus.chunks[i]);
+    }
+
+    CHECK(gameboy_hash(clone) == gameboy_hash(gb));
+
+    uint8_t *before = malloc(GAMEBOY_MEM_SIZE);
+    uint8_t *after = malloc(GAMEBOY_MEM_SIZE);
+
+    // Running the original leaves the clone alone...
+    bus_copy_out(&clone->bus, 0, before, GAMEBOY_MEM_SIZE);
+    uint64_t hash_before = gameboy_hash(clone);
+
+    run_frames(gb, 5);
+    bus_copy_out(&clone->bus, 0, after, GAMEBOY_MEM_SIZE);
+    CHECK(memcmp(before, after, GAMEBOY_MEM_SIZE) == 0);
+    CHECK(gameboy_hash(clone) == hash_before);
+
+    // ...and the other way round. Only the chunks written to stop being shared.
+    bus_copy_out(&gb->bus, 0, before, GAMEBOY_MEM_SIZE);
+    hash_before = gameboy_hash(gb);
+
+    run_frames(clone, 5);
+    bus_copy_out(&gb->bus, 0, after, GAMEBOY_MEM_SIZE);
+    CHECK(memcmp(before, after, GAMEBOY_MEM_SIZE) == 0);
+    CHECK(gameboy_hash(gb) == hash_before);
+    CHECK(clone->bus.chunks[0] == gb->bus.chunks[0]);
+    CHECK(clone->bus.chunks[0xc000 / BUS_CHUNK_SIZE] != gb->bus.chunks[0xc000 / BUS_CHUNK_SIZE]);
+
+    // Both ran the same frames from the same state.
+    CHECK(gameboy_hash(clone) == gameboy_hash(gb));
+
+    // The clone keeps its chunks alive after the original is gone.
+    uint64_t hash_clone = gameboy_hash(clone);
+    gameboy_destroy(gb);
+    CHECK(gameboy_hash(clone) == hash_clone);
+    run_frames(clone, 2);
+
+    // CB ops don't write yet, so RLC (HL) must not copy the chunk HL points into.
+    static const uint8_t rlc_hl[] = { 0xcb, 0x06 };
+    bus_copy_in(&clone->bus, 0x0200, rlc_hl, sizeof(rlc_hl));
+
+    gameboy_t *cb = gameboy_clone(clone);
+    cb->cpu.registers.dw.PC = 0x0200;
+    cb->cpu.registers.dw.HL = 0xc0c0;
+    cpu_tick(&cb->cpu, &cb->bus);
+    CHECK(cb->cpu.registers.dw.PC == 0x0202);
+    CHECK(cb->bus.chunks[0xc000 / BUS_CHUNK_SIZE] == clone->bus.chunks[0xc000 / BUS_CHUNK_SIZE]);
+
+    gameboy_destroy(cb);
+    gameboy_destroy(clone);
+    free(before);
+    free(after);
+    return 0;
+}
+
+static int test_bus_fingerprint(void) {
+    gameboy_t *gb = create_test_machine();
+    CHECK(gb != NULL);
+    run_frames(gb, 10);
+
+    gameboy_t *clone = gameboy_clone(gb);
+    CHECK(fingerprint_equal(gameboy_fingerprint(gb), gameboy_fingerprint(clone)));
+
+    // Same inputs, same state, same fingerprint, however the pages got there.
+    run_frames(gb, 5);
+    run_frames(clone, 5);
+    CHECK(gameboy_hash(gb) == gameboy_hash(clone));
+    CHECK(fingerprint_equal(gameboy_fingerprint(gb), gameboy_fingerprint(clone)));
+
+    // A single byte changes it, and putting the byte back restores it.
+    gameboy_fingerprint_t original = gameboy_fingerprint(clone);
+    uint8_t value = bus_read(&clone->bus, 0xc0c0);
+
+    bus_write(&clone->bus, 0xc0c0, (uint8_t) (value ^ 0x01));
+    CHECK(!fingerprint_equal(gameboy_fingerprint(clone), original));
+    bus_write(&clone->bus, 0xc0c0, value);
+    CHECK(fingerprint_equal(gameboy_fingerprint(clone), original));
+
+    // The incremental fingerprint matches one hashed from scratch.
+    uint8_t *state = malloc(savestate_size());
+    gameboy_t *fresh = gameboy_create();
+
+    savestate_save(gb, state);
+    CHECK(savestate_load(fresh, state, savestate_size()) == 0);
+    CHECK(fingerprint_equal(gameboy_fingerprint(fresh), gameboy_fingerprint(gb)));
+
+    gameboy_destroy(gb);
+    gameboy_destroy(clone);
+    gameboy_destroy(fresh);
+    free(state);
+    return 0;
+}
+
+static int test_savestate(void) {
+    gameboy_t *gb = create_test_machine();
+    CHECK(gb != NULL);
+    run_frames(gb, 20);
+
+    // Mid-frame, so the PPU position has to survive too.
+    for (int i = 0; i < 1000; i++) gameboy_step(gb);
+
+    size_t size = savestate_size();
+    uint8_t *state = malloc(size);
+    savestate_save(gb, state);
+
+    uint64_t saved = gameboy_hash(gb);
+    run_frames(gb, 30);
+    uint64_t expected = gameboy_hash(gb);
+
+    gameboy_t *other = gameboy_create();
+    CHECK(savestate_load(other, state, size) == 0);
+    CHECK(gameboy_hash(other) == saved);
+    run_frames(other, 30);
+    CHECK(gameboy_hash(other) == expected);
+
+    // Broken buffers are rejected and leave the instance untouched.
+    CHECK(savestate_load(other, state, size - 1) != 0);
+
+    state[0] ^= 0xff;
+    CHECK(savestate_load(other, state, size) != 0);
+    state[0] ^= 0xff;
+
+    savestate_header_t *header = (savestate_header_t *) state;
+    header->version++;
+    CHECK(savestate_load(other, state, size) != 0);
+    CHECK(gameboy_hash(other) == expected);
+
+    gameboy_destroy(gb);
+    gameboy_destroy(other);
+    free(state);
+    return 0;
+}
+
+// Skipped frames leave out drawing only, the window line counter and with it the save state have to match a rendered
+// frame.
+static int test_ppu_skip(void) {
+    static const uint8_t window[] = { 0x00, 0x07 }; // WY, WX: the window covers the whole screen.
+    static const uint8_t lcdc = 0xa1;               // LCD, window and background on.
+    gameboy_t *machines[2];
+    uint8_t *states[2];
+    uint8_t *framebuffer = calloc(1, PPU_WIDTH * PPU_HEIGHT);
+    size_t size = savestate_size();
+
+    for (int i = 0; i < 2; i++) {
+        machines[i] = create_test_machine();
+        CHECK(machines[i] != NULL);
+
+        bus_copy_in(&machines[i]->bus, 0xff40, &lcdc, 1);
+        bus_copy_in(&machines[i]->bus, 0xff4a, window, sizeof(window));
+        gameboy_set_render(machines[i], framebuffer, i == 0 ? 1 : 0);
+        run_frames(machines[i], 3);
+
+        states[i] = malloc(size);
+        savestate_save(machines[i], states[i]);
+    }
+
+    CHECK(machines[0]->ppu.window_line == PPU_HEIGHT);
+    CHECK(machines[1]->ppu.window_line == machines[0]->ppu.window_line);
+    CHECK(memcmp(states[0], states[1], size) == 0);
+
+    for (int i = 0; i < 2; i++) {
+        gameboy_destroy(machines[i]);
+        free(states[i]);
+    }
+
+    free(framebuffer);
+    return 0;
+}
+
+#define TEST_MOVIE_FRAMES 120
+
+static int test_movie_seek(void) {
+    uint64_t hashes[TEST_MOVIE_FRAMES + 1];
+    gameboy_t *gb = create_test_machine();
+    CHECK(gb != NULL);
+
+    movie_t *movie = movie_create(16);
+
+    for (int frame = 0; frame < TEST_MOVIE_FRAMES; frame++) {
+        hashes[frame] = gameboy_hash(gb);
+        gb->joypad = test_input(gb->frames);
+        movie_record_frame(movie, gb);
+    }
+    hashes[TEST_MOVIE_FRAMES] = gameboy_hash(gb);
+    CHECK(hashes[TEST_MOVIE_FRAMES] != hashes[TEST_MOVIE_FRAMES - 1]);
+
+    // Seeking anywhere, forwards or backwards, ends up where the recording run was at that frame.
+    static const uint64_t targets[] = { 0, 1, 15, 16, 17, 63, 100, TEST_MOVIE_FRAMES, 40, 3 };
+    gameboy_t *player = create_test_machine();
+
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        CHECK(movie_seek(movie, player, targets[i]) == 0);
+        CHECK(player->frames == targets[i]);
+        CHECK(gameboy_hash(player) == hashes[targets[i]]);
+    }
+
+    CHECK(movie_seek(movie, player, TEST_MOVIE_FRAMES + 1) != 0);
+
+    // Playing on from a seek reproduces the rest of the run.
+    CHECK(movie_seek(movie, player, 50) == 0);
+    while (movie_play_frame(movie, player) == 0) {}
+    CHECK(gameboy_hash(player) == hashes[TEST_MOVIE_FRAMES]);
+
+    movie_free(movie);
+    gameboy_destroy(gb);
+    gameboy_destroy(player);
+    return 0;
+}
+
+#define TEST_REWIND_FRAMES 200
+
+static int test_rewind(void) {
+    uint64_t hashes[TEST_REWIND_FRAMES + 1];
+    gameboy_t *gb = create_test_machine();
+    CHECK(gb != NULL);
+
+    // Room for 100 frames, but only a few keyframes, so old frames get evicted both ways.
+    rewind_t *rw = rewind_create(6 * savestate_size(), 100, 16);
+    CHECK(rw != NULL);
+
+    for (int frame = 1; frame <= TEST_REWIND_FRAMES; frame++) {
+        run_frames(gb, 1);
+        hashes[frame] = gameboy_hash(gb);
+
+        // Fingerprinting in between takes the dirty marks away from rewind, it has to notice through the hashes.
+        if (frame % 9 == 0) gameboy_fingerprint(gb);
+        CHECK(rewind_push(rw, gb) == 0);
+    }
+
+    size_t available = rewind_available(rw);
+    CHECK(available > 16 && available <= 100);
+    CHECK(rewind_seek(rw, gb, available) != 0);
+
+    // Seeking to frame N gives the state a straight run had after frame N.
+    CHECK(rewind_seek(rw, gb, 0) == 0);
+    CHECK(gameboy_hash(gb) == hashes[TEST_REWIND_FRAMES]);
+
+    CHECK(rewind_seek(rw, gb, 20) == 0);
+    CHECK(gb->frames == TEST_REWIND_FRAMES - 20);
+    CHECK(gameboy_hash(gb) == hashes[TEST_REWIND_FRAMES - 20]);
+    CHECK(rewind_available(rw) == available - 20);
+
+    // Recording on from there, then seeking back into the frames pushed after the seek.
+    for (int frame = TEST_REWIND_FRAMES - 19; frame <= TEST_REWIND_FRAMES; frame++) {
+        run_frames(gb, 1);
+        CHECK(gameboy_hash(gb) == hashes[frame]);
+        CHECK(rewind_push(rw, gb) == 0);
+    }
+
+    CHECK(rewind_seek(rw, gb, 5) == 0);
+    CHECK(gameboy_hash(gb) == hashes[TEST_REWIND_FRAMES - 5]);
+
+    CHECK(rewind_seek(rw, gb, rewind_available(rw) - 1) == 0);
+    CHECK(gameboy_hash(gb) == hashes[gb->frames]);
+
+    rewind_destroy(rw);
+    gameboy_destroy(gb);
+    return 0;
+}
+
+// Taken JR NC/NZ inside a called function must not look like calls, and every RET has to pop what its CALL pushed.
+static int test_symprof(void) {
+    static const char source[] =
+        "    org $100\n"
+        "    scf\n"
+        "    jr c, main\n"
+        "\n"
+        "    org $150\n"
+        "main:\n"
+        "    ld b, 3\n"
+        ".loop:\n"
+        "    call work\n"
+        "    dec b\n"
+        "    jr z, .done\n"
+        "    scf\n"
+        "    jr c, .loop\n"
+        ".done:\n"
+        "    stop\n"
+        "\n"
+        "    org $2020\n"
+        "work:\n"
+        "    and a\n"
+        "    jr nc, .carry_clear\n"
+        "    nop\n"
+        ".carry_clear:\n"
+        "    or a\n"
+        "    jr nz, .not_zero\n"
+        "    nop\n"
+        ".not_zero:\n"
+        "    ret\n";
+    static const char symbol_file[] = "00:0100 start\n00:0150 main\n00:2020 work\n";
+
+    uint8_t *rom = calloc(1, GAMEBOY_ROM_SIZE);
+    asm_error_t error;
+    CHECK(asm_assemble(source, rom, GAMEBOY_ROM_SIZE, &error) >= 0);
+
+    char path[] = "/tmp/cgb_tests_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    CHECK(write(fd, symbol_file, sizeof(symbol_file) - 1) == (ssize_t) sizeof(symbol_file) - 1);
+    close(fd);
+
+    symbols_t symbols;
+    int loaded = symbols_load(&symbols, path);
+    unlink(path);
+    CHECK(loaded == 0);
+
+    gameboy_t *gb = gameboy_create();
+    gameboy_reset(gb, rom, GAMEBOY_ROM_SIZE);
+
+    symprof_t *profiler = symprof_attach(gb, &symbols);
+    gameboy_run_frame(gb);
+    CHECK(gb->cpu.state.stopped);
+
+    // main is reached through JR, so it runs in the root frame of start.
+    FILE *folded = tmpfile();
+    char line[256];
+    int lines = 0;
+
+    symprof_write_folded(profiler, folded);
+    rewind(folded);
+
+    while (fgets(line, sizeof(line), folded) != NULL) {
+        CHECK(strncmp(line, "start ", 6) == 0 || strncmp(line, "start;work ", 11) == 0);
+        lines++;
+    }
+
+    CHECK(lines == 2);
+
+    fclose(folded);
+    symprof_detach(profiler);
+    symbols_free(&symbols);
+    gameboy_destroy(gb);
+    free(rom);
+    return 0;
+}
+
+// A scope that spans a close and the next open must be dropped, not written into the freed buffer of the first timeline.
+static int test_timeline(void) {
+    char path[] = "/tmp/cgb_tests_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+
+    CHECK(timeline_open(path) == 0);
+    timeline_end("first", timeline_begin());
+    uint64_t spanning = timeline_begin();
+    CHECK(spanning != 0);
+    CHECK(timeline_close() == 0);
+
+    CHECK(timeline_open(path) == 0);
+    timeline_end("spanning", spanning);
+    timeline_end("second", timeline_begin());
+    CHECK(timeline_close() == 0);
+
+    timeline_end("closed", spanning);
+
+    FILE *trace = fopen(path, "r");
+    CHECK(trace != NULL);
+
+    char contents[4096];
+    size_t size = fread(contents, 1, sizeof(contents) - 1, trace);
+    contents[size] = '\0';
+    fclose(trace);
+    unlink(path);
+
+    CHECK(strstr(contents, "\"name\":\"second\"") != NULL);
+    CHECK(strstr(contents, "\"name\":\"spanning\"") == NULL);
+    CHECK(strstr(contents, "\"name\":\"first\"") == NULL);
+    return 0;
+}
+
+// Shades with diagonal edges, single pixels and flat areas, so every Scale2x/3x rule fires somewhere.
+static void test_frame(uint8_t *framebuffer) {
+    for (int y = 0; y < PPU_HEIGHT; y++) {
+        for (int x = 0; x < PPU_WIDTH; x++) {
+            int shade = (x + y) / 9 % 4;
+            if ((x * 7 + y * 13) % 31 == 0) shade = 3 - shade;
+            if (x > 100 && y > 80) shade = x / 16 % 2 ? 1 : 2;
+
+            framebuffer[y * PPU_WIDTH + x] = (uint8_t) shade;
+        }
+    }
+}
+
+static uint32_t clamped(const uint32_t *src, int width, int height, int x, int y) {
+    x = x < 0 ? 0 : x >= width ? width - 1 : x;
+    y = y < 0 ? 0 : y >= height ? height - 1 : y;
+
+    return src[y * width + x];
+}
+
+// Plain AdvMAME Scale2x, edges repeated like the scaler's border.
+static void reference_scale2x(const uint32_t *src, int width, int height, uint32_t *dst) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint32_t b = clamped(src, width, height, x, y - 1), d = clamped(src, width, height, x - 1, y);
+            uint32_t e = src[y * width + x];
+            uint32_t f = clamped(src, width, height, x + 1, y), h = clamped(src, width, height, x, y + 1);
+            uint32_t *out = dst + 2 * y * 2 * width + 2 * x;
+            uint32_t e0 = e, e1 = e, e2 = e, e3 = e;
+
+            if (b != h && d != f) {
+                if (d == b) e0 = d;
+                if (b == f) e1 = f;
+                if (d == h) e2 = d;
+                if (h == f) e3 = f;
+            }
+
+            out[0] = e0;
+            out[1] = e1;
+            out[2 * width] = e2;
+            out[2 * width + 1] = e3;
+        }
+    }
+}
+
+static void reference_scale3x(const uint32_t *src, int width, int height, uint32_t *dst) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint32_t a = clamped(src, width, height, x - 1, y - 1), b = clamped(src, width, height, x, y - 1);
+            uint32_t c = clamped(src, width, height, x + 1, y - 1), d = clamped(src, width, height, x - 1, y);
+            uint32_t e = src[y * width + x], f = clamped(src, width, height, x + 1, y);
+            uint32_t g = clamped(src, width, height, x - 1, y + 1), h = clamped(src, width, height, x, y + 1);
+            uint32_t i = clamped(src, width, height, x + 1, y + 1);
+            uint32_t *out = dst + 3 * y * 3 * width + 3 * x;
+            size_t row = 3 * width;
+
+            out[0] = d == b && b != f && d != h ? d : e;
+            out[1] = (d == b && b != f && d != h && e != c) || (b == f && b != d && f != h && e != a) ? b : e;
+            out[2] = b == f && b != d && f != h ? f : e;
+            out[row] = (d == b && b != f && d != h && e != g) || (d == h && d != b && h != f && e != a) ? d : e;
+            out[row + 1] = e;
+            out[row + 2] = (b == f && b != d && f != h && e != i) || (h == f && d != h && b != f && e != c) ? f : e;
+            out[2 * row] = d == h && d != b && h != f ? d : e;
+            out[2 * row + 1] = (d == h && d != b && h != f && e != i) || (h == f && d != h && b != f && e != g) ? h : e;
+            out[2 * row + 2] = h == f && d != h && b != f ? f : e;
+        }
+    }
+}
+
+static int test_scaler(void) {
+    size_t src_pitch = PPU_WIDTH * sizeof(uint32_t);
+    size_t max_size = (size_t) 4 * PPU_WIDTH * 4 * PPU_HEIGHT;
+    uint8_t *framebuffer = malloc(PPU_WIDTH * PPU_HEIGHT);
+    uint32_t *src = malloc(src_pitch * PPU_HEIGHT);
+    uint32_t *doubled = malloc(max_size / 4 * sizeof(uint32_t));
+    uint32_t *expected = malloc(max_size * sizeof(uint32_t));
+    uint32_t *single = malloc(max_size * sizeof(uint32_t));
+    uint32_t *pooled = malloc(max_size * sizeof(uint32_t));
+
+    test_frame(framebuffer);
+    CHECK(video_convert(framebuffer, &video_palette_dmg, VIDEO_RGBA8888, 1, src, src_pitch) == 0);
+
+    // 5 workers make 10 strips, which don't divide the 144 rows evenly.
+    scaler_t *one = scaler_create(1);
+    scaler_t *pool = scaler_create(5);
+
+    for (int filter = 0; filter < SCALER_COUNT; filter++) {
+        int factor = scaler_factor(filter);
+        size_t pitch = factor * PPU_WIDTH * sizeof(uint32_t);
+        size_t pixels = (size_t) factor * PPU_WIDTH * factor * PPU_HEIGHT;
+
+        memset(single, 0, max_size * sizeof(uint32_t));
+        memset(pooled, 0xff, max_size * sizeof(uint32_t));
+        CHECK(scaler_run(one, filter, src, src_pitch, single, pitch) == 0);
+        CHECK(scaler_run(pool, filter, src, src_pitch, pooled, pitch) == 0);
+        CHECK(memcmp(single, pooled, pixels * sizeof(uint32_t)) == 0);
+
+        switch (filter) {
+            case SCALER_SCALE2X: reference_scale2x(src, PPU_WIDTH, PPU_HEIGHT, expected); break;
+            case SCALER_SCALE3X: reference_scale3x(src, PPU_WIDTH, PPU_HEIGHT, expected); break;
+
+            case SCALER_SCALE4X:
+                reference_scale2x(src, PPU_WIDTH, PPU_HEIGHT, doubled);
+                reference_scale2x(doubled, 2 * PPU_WIDTH, 2 * PPU_HEIGHT, expected);
+                break;
+
+            default: continue; // xBR blends, it only has to agree with itself across thread counts.
+        }
+
+        for (size_t i = 0; i < pixels; i++) {
+            if (pooled[i] == expected[i]) continue;
+
+            fprintf(stderr, "%s differs at %zu, %zu\n", scaler_name(filter), i % (factor * PPU_WIDTH),
+                    i / (factor * PPU_WIDTH));
+            CHECK(pooled[i] == expected[i]);
+        }
+    }
+
+    CHECK(scaler_run(one, SCALER_COUNT, src, src_pitch, single, src_pitch) != 0);
+
+    scaler_destroy(one);
+    scaler_destroy(pool);
+    free(framebuffer);
+    free(src);
+    free(doubled);
+    free(expected);
+    free(single);
+    free(pooled);
+    return 0;
+}
+
+// Every format at scale 3 has to be the scale 1 output with each pixel repeated 3 times in both directions.
+static int test_video(void) {
+    static const video_format_t formats[] = { VIDEO_RGBA8888, VIDEO_BGRA8888, VIDEO_RGB565 };
+    uint8_t *framebuffer = malloc(PPU_WIDTH * PPU_HEIGHT);
+    uint8_t *small = malloc(PPU_WIDTH * PPU_HEIGHT * 4);
+    uint8_t *large = malloc(3 * PPU_WIDTH * 3 * PPU_HEIGHT * 4);
+
+    test_frame(framebuffer);
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        int size = video_pixel_size(formats[f]);
+        size_t pitch = PPU_WIDTH * size;
+        size_t large_pitch = 3 * pitch;
+
+        CHECK(video_convert(framebuffer, &video_palette_dmg, formats[f], 1, small, pitch) == 0);
+        CHECK(video_convert(framebuffer, &video_palette_dmg, formats[f], 3, large, large_pitch) == 0);
+
+        for (int y = 0; y < 3 * PPU_HEIGHT; y++) {
+            for (int x = 0; x < 3 * PPU_WIDTH; x++) {
+                CHECK(memcmp(large + y * large_pitch + x * size, small + y / 3 * pitch + x / 3 * size, size) == 0);
+            }
+        }
+    }
+
+    // Lightest DMG shade 0x9bbc0f in each layout.
+    uint8_t pixel[4];
+    uint16_t rgb565;
+    framebuffer[0] = 0;
+
+    video_convert(framebuffer, &video_palette_dmg, VIDEO_RGBA8888, 1, small, PPU_WIDTH * 4);
+    memcpy(pixel, small, 4);
+    CHECK(pixel[0] == 0x9b && pixel[1] == 0xbc && pixel[2] == 0x0f && pixel[3] == 0xff);
+
+    video_convert(framebuffer, &video_palette_dmg, VIDEO_BGRA8888, 1, small, PPU_WIDTH * 4);
+    memcpy(pixel, small, 4);
+    CHECK(pixel[0] == 0x0f && pixel[1] == 0xbc && pixel[2] == 0x9b && pixel[3] == 0xff);
+
+    video_convert(framebuffer, &video_palette_dmg, VIDEO_RGB565, 1, small, PPU_WIDTH * 2);
+    memcpy(&rgb565, small, 2);
+    CHECK(rgb565 == (0x9b >> 3 << 11 | 0xbc >> 2 << 5 | 0x0f >> 3));
+
+    CHECK(video_convert(framebuffer, &video_palette_dmg, VIDEO_RGBA8888, VIDEO_SCALE_MAX + 1, large, PPU_WIDTH * 4) != 0);
+
+    free(framebuffer);
+    free(small);
+    free(large);
+    return 0;
+}
+
+static int test_asm(void) {
+    static const char source[] =
+        "VALUE equ $12\n"
+        "    org $10\n"
+        "start:\n"
+        "    ld a, VALUE\n"
+        "    ld hl, $1234\n"
+        "    ld [hl+], a\n"
+        ".back:\n"
+        "    ldh [$44], a\n"
+        "    jr nz, .back\n"
+        "    call start\n"
+        "    bit 7, h\n"
+        "    db \"ok\", LOW($abcd)\n"
+        "    dw @\n";
+    static const uint8_t expected[] = {
+        0x3e, 0x12,
+        0x21, 0x34, 0x12,
+        0x22,
+        0xe0, 0x44,
+        0x20, 0xfc,
+        0xcd, 0x10, 0x00,
+        0xcb, 0x7c,
+        'o', 'k', 0xcd,
+        0x22, 0x00,
+    };
+
+    uint8_t image[1024];
+    asm_error_t error;
+    memset(image, 0, sizeof(image));
+
+    long size = asm_assemble(source, image, sizeof(image), &error);
+    if (size < 0) fprintf(stderr, "line %d: %s\n", error.line, error.message);
+
+    CHECK(size == 0x10 + (long) sizeof(expected));
+    CHECK(memcmp(image + 0x10, expected, sizeof(expected)) == 0);
+
+    // Errors point at their line.
+    CHECK(asm_assemble("    nop\n    frob a\n", image, sizeof(image), &error) < 0);
+    CHECK(error.line == 2);
+    CHECK(asm_assemble("    jr far\n    org $200\nfar:\n", image, sizeof(image), &error) < 0);
+
+    return 0;
+}
+
+static const struct {
+    const char *name;
+    int (*run)(void);
+} tests[] = {
+    { "bus_clone", test_bus_clone },
+    { "bus_fingerprint", test_bus_fingerprint },
+    { "savestate", test_savestate },
+    { "ppu_skip", test_ppu_skip },
+    { "movie_seek", test_movie_seek },
+    { "rewind", test_rewind },
+    { "symprof", test_symprof },
+    { "timeline", test_timeline },
+    { "scaler", test_scaler },
+    { "video", test_video },
+    { "asm", test_asm },
+};
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: cgb_tests <case>\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        if (strcmp(argv[1], tests[i].name) == 0) {
+            return tests[i].run() == 0 ? 0 : 1;
+        }
+    }
+
+    fprintf(stderr, "Unknown test case %s\n", argv[1]);
+    return 1;
+}